@@ -0,0 +1,64 @@
+#! /bin/bash
+#===========================================================
+#runs the bidir module on test_ij_joint.BedGraph through every template scan
+#path and diffs the -scores and prelim_bidir_hits.bed output against the plain
+#scan at the same -fp_res; exits 1 if any differ
+#
+#	-fft 1       FFT correlation instead of the sliding window
+#	-pyramid 1   coverage block sums prune the scan
+#	-pyramid 2   full scan, logs what -pyramid 1 would have missed
+#	-tile        windowed scan of each chromosome
+#	-fp_res      footprint steps of the template, odd and even (-fft packs two
+#	             steps per inverse transform)
+#
+#bidir bins onto an implicit grid, so every run here goes through the tabulated
+#EMG kernel; windows without reads and bins whose window coverage can't pass
+#check_hit skip BIC3 in all of them, and -scores holds NA there: no NA bin may
+#be a hit
+#
+#one OpenMP thread: every thread starts its sliding window at its first bin, so
+#-scores near thread boundaries depends on the thread count
+#
+#usage: check_scan_paths.sh [/path/to/Tfit]
+#===========================================================
+here=$(cd "$(dirname "$0")" && pwd)
+src=${1:-${here}/../src/Tfit} #path to Tfit
+input_bedgraph=${here}/test_ij_joint.BedGraph
+config_file=${here}/config_file.txt
+out=$(mktemp -d)
+export OMP_NUM_THREADS=1
+
+run(){ #name, options
+	mkdir -p ${out}/$1
+	$src bidir -config $config_file -v 0 -ij $input_bedgraph ${@:2} \
+		-o ${out}/$1/ -log_out ${out}/$1/ -scores ${out}/$1/scores.bg > /dev/null
+}
+hits(){
+	grep -v '^#' ${out}/$1/*_prelim_bidir_hits.bed
+}
+
+failed=0
+for fp_res in 5 4; do
+	run ref_${fp_res} -fp_res $fp_res
+	if awk -F'\t' '$4 == "NA" && $7 == 1 {exit 1}' ${out}/ref_${fp_res}/scores.bg; then
+		echo "ok     -fp_res ${fp_res}: no NA bin is a hit"
+	else
+		echo "FAILED -fp_res ${fp_res}: a bin without BIC3 is a hit"
+		failed=1
+	fi
+	for opts in "-fft 1" "-pyramid 1" "-pyramid 2" "-tile 200000" "-tile 200000 -fft 1" "-fft 1 -pyramid 1"; do
+		name=$(echo "${fp_res} ${opts}" | tr -d ' -')
+		run $name -fp_res $fp_res $opts
+		if cmp -s ${out}/ref_${fp_res}/scores.bg ${out}/${name}/scores.bg \
+			&& diff -q <(hits ref_${fp_res}) <(hits $name) > /dev/null; then
+			echo "ok     -fp_res ${fp_res} ${opts}"
+		else
+			echo "FAILED -fp_res ${fp_res} ${opts} (output in ${out}/${name})"
+			failed=1
+		fi
+	done
+done
+if [ $failed == 0 ]; then
+	rm -rf $out
+fi
+exit $failed
@@ -9,26 +9,57 @@ double gaussian(double x, double mu, double sigma){
 
 
 
-double BIC3(double ** X, int j, int k, int i,
+double BIC3(coverage_view X, int j, int k, int i,
             double N_pos, double N_neg,
-            double sigma, double lambda, double fp, double pi, double w) {
-   int res         = 5;
+            double sigma, double lambda, double fp, double pi, double w, int res, bic3_scratch & S) {
+   if (X.pos == NULL) {
+      return BIC3_kernel<true>(X, j, k, i, N_pos, N_neg, sigma, lambda, fp, pi, w, res, S);
+   }
+   return BIC3_kernel<false>(X, j, k, i, N_pos, N_neg, sigma, lambda, fp, pi, w, res, S);
+}
+
+//step is the bin width and window the half width of a scan window (-ns scale)
+emg_table::emg_table(double SI, double L, double FP, double PI, double w_, double step, double window, int RES) {
+   sigma = SI, lambda = L, fp = FP, pi = PI, w = w_;
+   res   = RES;
+   W     = int(window / step) + 2;
+   F.resize(res * (2 * W + 1)), R.resize(res * (2 * W + 1));
+   EMG Ef(0, sigma, lambda, 1.0, 1.0), Er(0, sigma, lambda, 1.0, 0.0);
+   vector<double> x(2 * W + 1), work(2 * W + 1);
+   for (int o = -W; o <= W; o++) {
+      x[o + W]  = o * step;
+   }
+   for (int rs = 0; rs < res; rs++) {
+      Ef.foot_print  = rs * (fp / res), Er.foot_print = rs * (fp / res);
+      Ef.pdf_batch(x.data(), 2 * W + 1, 1, &F[rs * (2 * W + 1)], work.data());
+      Er.pdf_batch(x.data(), 2 * W + 1, -1, &R[rs * (2 * W + 1)], work.data());
+   }
+   log_batch(F.data(), F.size(), F.data());
+   log_batch(R.data(), R.size(), R.data());
+}
+
+//BIC3 on an implicit grid: log(pdf) of the EMG is the table entry plus the log
+//strand weight, which is summed over the window once instead of per bin
+double BIC3_tabulated(const emg_table & T, coverage_view X, int j, int k, int i,
+                      double N_pos, double N_neg, bic3_scratch & S) {
+   if (i - j > T.W or k - i > T.W) {
+      return BIC3_kernel<true>(X, j, k, i, N_pos, N_neg, T.sigma, T.lambda, T.fp, T.pi, T.w, T.res, S);
+   }
    double N        = N_pos + N_neg;
-   double l        = X[0][k] - X[0][j];
+   double l        = (k * X.delta) / X.scale - (j * X.delta) / X.scale;
    double pi2      = (N_pos + 10000) / (N_neg + N_pos + 20000);
    double uni_ll   = log(pi2 /   l ) *  N_pos  + log((1 - pi2) /  l ) * N_neg ;
-   double MU       = X[0][i];
-   double fp_delta = fp / res, best_ll = 0;
-   EMG EMG_clf(MU, sigma, lambda, 1.0, pi2 );
-   for (int rs = 0 ; rs < res; rs++){
-      double emg_ll   = 0, p1 = 0.0, p2 = 0.0;
-      EMG_clf.foot_print      = rs*fp_delta;
+   double best_ll  = 0, S_f = 0, S_r = 0;
+   for (int iter = j; iter < k; iter++ ) {
+      S_f   += X.fwd[iter], S_r += X.rev[iter];
+   }
+   double strand_ll  = log(pi2) * S_f + log(1 - pi2) * S_r;
+   for (int rs = 0 ; rs < T.res; rs++){
+      const double * F  = &T.F[rs * (2 * T.W + 1) + T.W];
+      const double * R  = &T.R[rs * (2 * T.W + 1) + T.W];
+      double emg_ll     = strand_ll;
       for (int iter = j; iter < k; iter++ ) {
-         p1 = EMG_clf.pdf(X[0][iter] , 1)  ;
-         p2 = EMG_clf.pdf(X[0][iter] , -1) ;
-
-         emg_ll += log( p1 ) *  X[1][iter]  ;
-         emg_ll += log( p2 ) *  X[2][iter] ;
+         emg_ll += F[iter - i] * X.fwd[iter] + R[iter - i] * X.rev[iter];
       }
       if (emg_ll > best_ll || rs==0){
          best_ll  = emg_ll;
@@ -39,3 +70,23 @@ double BIC3(double ** X, int j, int k, int i,
    return arg_bic;
 }
 
+//BIC3 on an implicit grid when the table sums of the window (emg[rs * stride]
+//for each footprint step, without the strand weight) are already known, -fft
+double BIC3_correlated(const emg_table & T, coverage_view X, int j, int k, const double * emg, int stride,
+                       double N_pos, double N_neg) {
+   double N        = N_pos + N_neg;
+   double l        = (k * X.delta) / X.scale - (j * X.delta) / X.scale;
+   double pi2      = (N_pos + 10000) / (N_neg + N_pos + 20000);
+   double uni_ll   = log(pi2 /   l ) *  N_pos  + log((1 - pi2) /  l ) * N_neg ;
+   double strand_ll  = log(pi2) * N_pos + log(1 - pi2) * N_neg;
+   double best_ll  = 0;
+   for (int rs = 0 ; rs < T.res; rs++){
+      double emg_ll   = strand_ll + emg[rs * stride];
+      if (emg_ll > best_ll || rs==0){
+         best_ll  = emg_ll;
+      }
+   }
+
+   double arg_bic =  (-2*uni_ll + log(N))/(-2*best_ll + log(N)*4)      ;
+   return arg_bic;
+}
@@ -1 +1,93 @@
-double BIC3(double **, int, int, int , double, double,  double, double, double, double, double);
+#ifndef BIC_H
+#define BIC_H
+#include "load.h"
+#include "model.h"
+#include "simd_math.h"
+#include <cmath>
+
+//working space of BIC3_kernel, each scanning thread keeps one so the kernel
+//doesn't allocate per bin
+class bic3_scratch{
+public:
+	vector<double> emg_ll, shift, arg, E, A, L;
+};
+
+//BIC ratio of the EMG template centered on bin i against a uniform over bins
+//[j, k); grid picks the layout at compile time, positions are computed
+//(coverage_view::x) instead of loaded on an implicit grid
+template <bool grid>
+double BIC3_kernel(coverage_view X, int j, int k, int i,
+                   double N_pos, double N_neg,
+                   double sigma, double lambda, double fp, double pi, double w, int res,
+                   bic3_scratch & S) {
+   double N        = N_pos + N_neg;
+   double l        = (grid ? (k * X.delta) / X.scale : X.pos[k]) - (grid ? (j * X.delta) / X.scale : X.pos[j]);
+   double pi2      = (N_pos + 10000) / (N_neg + N_pos + 20000);
+   double uni_ll   = log(pi2 /   l ) *  N_pos  + log((1 - pi2) /  l ) * N_neg ;
+   double MU       = grid ? (i * X.delta) / X.scale : X.pos[i];
+   double fp_delta = fp / res, best_ll = 0;
+   //moving either strand's EMG (EMG::pdf) out by a footprint f scales exp(vl) by
+   //exp(lambda f) and adds f / (sqrt(2) sigma) to the erfc argument, so exp is
+   //taken once per bin and strand and every footprint step keeps its own sum;
+   //exp, erfc and log of the whole window go through simd_math at once
+   int n           = k - j;
+   vector<double> & emg_ll = S.emg_ll, & shift = S.shift, & arg = S.arg;
+   vector<double> & E = S.E, & A = S.A, & L = S.L;
+   emg_ll.assign(res, 0.0), shift.resize(res), arg.resize(res);
+   for (int rs = 0; rs < res; rs++) {
+      shift[rs] = exp(lambda * rs * fp_delta);
+      arg[rs]   = rs * fp_delta / (sqrt(2) * sigma);
+   }
+   E.resize(2 * n), A.resize(2 * n), L.resize(2 * n);
+   double ls2      = lambda * pow(sigma, 2), rs2 = sqrt(2) * sigma, P_MAX = pow(10, 7);
+   for (int iter = j; iter < k; iter++ ) {
+      double x   = grid ? (iter * X.delta) / X.scale : X.pos[iter];
+      E[iter - j]       = (lambda / 2.0) * (2 * (MU - x) + ls2);
+      A[iter - j]       = ((MU - x) + ls2 ) / rs2;
+      E[n + iter - j]   = (lambda / 2.0) * (-2 * (MU - x) + ls2);
+      A[n + iter - j]   = (-(MU - x) + ls2 ) / rs2;
+   }
+   exp_batch(E.data(), 2 * n, E.data());
+   for (int at = 0; at < 2 * n; at++) {
+      E[at]   = (lambda / 2) * E[at] * (at < n ? pi2 : 1 - pi2);
+   }
+   for (int rs = 0 ; rs < res; rs++){
+      for (int at = 0; at < 2 * n; at++) {
+         L[at]  = A[at] + arg[rs];
+      }
+      erfc_batch(L.data(), 2 * n, L.data());
+      for (int at = 0; at < 2 * n; at++) {
+         double p  = E[at] * shift[rs] * L[at];
+         L[at]     = (p < P_MAX and not isnan(float(p))) ? p : 0.0;
+      }
+      log_batch(L.data(), 2 * n, L.data());
+      for (int iter = j; iter < k; iter++ ) {
+         emg_ll[rs] += L[iter - j] * X.fwd[iter];
+         emg_ll[rs] += L[n + iter - j] * X.rev[iter];
+      }
+   }
+   for (int rs = 0 ; rs < res; rs++){
+      if (emg_ll[rs] > best_ll || rs==0){
+         best_ll  = emg_ll[rs];
+      }
+   }
+
+   double arg_bic =  (-2*uni_ll + log(N))/(-2*best_ll + log(N)*4)      ;
+   return arg_bic;
+}
+
+//log EMG densities of the template, mu = 0 and no strand weight, at bin offsets
+//-W..W for each footprint step of BIC3; on an implicit grid the distance of two
+//bins only depends on their index difference, so BIC3_tabulated looks them up
+class emg_table{
+public:
+	int W, res;
+	double sigma, lambda, fp, pi, w;
+	vector<double> F, R; //[rs * (2W + 1) + offset + W]
+	emg_table(double, double, double, double, double, double, double, int);
+};
+
+double BIC3(coverage_view, int, int, int , double, double,  double, double, double, double, double, int, bic3_scratch &);
+double BIC3_tabulated(const emg_table &, coverage_view, int, int, int, double, double, bic3_scratch &);
+double BIC3_correlated(const emg_table &, coverage_view, int, int, const double *, int, double, double);
+#endif
@@ -191,6 +191,7 @@ slice_ratio get_slice(vector<segment *> segments, int N, double CC, params * P){
   sigma         = stod(P->p["-sigma"])/ns , lambda= ns/stod(P->p["-lambda"]);
   fp            = stod(P->p["-foot_print"])/ns , pi= stod(P->p["-pi"]), w= stod(P->p["-w"]);
   pval_threshold= stod(P->p["-bct"]) ;
+  int fp_res    = stoi(P->p["-fp_res"]);
   int CN     = segments.size();
   double min_x  = -1 , max_x = -1, n = 0;
   random_device rd;
@@ -202,31 +203,36 @@ slice_ratio get_slice(vector<segment *> segments, int N, double CC, params * P){
   for (int i = 0 ; i < XY.size(); i++){
     XY[i]=0.0, CovN[i]=0.0;
   }
-  #pragma omp parallel for
-  for (int n = 0 ; n < N ; n++){
-    double U       = distribution(mt);
-    double U2      = distribution(mt);
-    int NN         = int(U*(CN-1));
-    segment * data = segments[NN];
-    int c          = U2*int(data->XN);
-    int j = c,  k  = c;
-    double N_pos = 0 , N_neg =0 ;
-    while (j > 0 and (data->X[0][c] - data->X[0][j] )< window){
-      N_pos+=data->X[1][j];
-      N_neg+=data->X[2][j];
-      j--;
-    }
-    while (k < data->XN and (data->X[0][k] - data->X[0][c] )< window  ){
-      N_pos+=data->X[1][k];
-      N_neg+=data->X[2][k];
-      k++;
-    }
-    CovN[n] = N_pos + N_neg;
-    if (N_pos + N_neg > CC and (data->X[0][k] - data->X[0][j]) > 1.75*window  ){
+  #pragma omp parallel
+  {
+    bic3_scratch S;
+    #pragma omp for
+    for (int n = 0 ; n < N ; n++){
+      double U       = distribution(mt);
+      double U2      = distribution(mt);
+      int NN         = int(U*(CN-1));
+      segment * data = segments[NN];
+      coverage_view X = data->view();
+      int c          = U2*int(data->XN);
+      int j = c,  k  = c;
+      double N_pos = 0 , N_neg =0 ;
+      while (j > 0 and (X.x(c) - X.x(j) )< window){
+        N_pos+=X.fwd[j];
+        N_neg+=X.rev[j];
+        j--;
+      }
+      while (k < data->XN and (X.x(k) - X.x(c) )< window  ){
+        N_pos+=X.fwd[k];
+        N_neg+=X.rev[k];
+        k++;
+      }
+      CovN[n] = N_pos + N_neg;
+      if (N_pos + N_neg > CC and (X.x(k) - X.x(j)) > 1.75*window  ){
       
-      double val =  BIC3(data->X,  j,  k,  c, N_pos,  N_neg, sigma , lambda, fp , pi, w);
-      if (val >0 ){
-        XY[n]=val,CovN[n]=N_pos+N_neg;
+        double val =  BIC3(X,  j,  k,  c, N_pos,  N_neg, sigma , lambda, fp , pi, w, fp_res, S);
+        if (val >0 ){
+          XY[n]=val,CovN[n]=N_pos+N_neg;
+        }
       }
     }
   }
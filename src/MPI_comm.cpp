@@ -33,35 +33,28 @@ vector<segment *> MPI_comm::slice_segments(vector<segment *> segments, int rank,
   return new_segs;	
 }
 
-struct bounds{
-public:
-  double lower_upper[5];
-};
 int MPI_comm::gather_all_bidir_predicitions(vector<segment *> all, 
 					    vector<segment *> segments , 
 					    int rank, int nprocs, string out_file_dir, string job_name, int job_ID, params * P, int noise){
-  
   map<string , vector<vector<double> > > G;
-  map<string , vector<vector<double> > > A;
+  return gather_all_bidir_predicitions(all, segments, rank, nprocs, out_file_dir, job_name, job_ID, P, noise, G);
+}
+
+//G is left with every prediction on rank 0 (chromosome -> lower, upper, ...)
+//each process sends its whole slice at once (counts per segment, then all
+//bounds), so many small contigs don't cost a message each
+int MPI_comm::gather_all_bidir_predicitions(vector<segment *> all, 
+					    vector<segment *> segments , 
+					    int rank, int nprocs, string out_file_dir, string job_name, int job_ID, params * P, int noise,
+					    map<string , vector<vector<double> > > & G){
+  
   //insert data from root
   int N 	= all.size();
-  int S;
   int count 	= N/ nprocs;
   
   if (count==0){
     count 	= 1;
   }
-  bounds B;
-  MPI_Datatype mystruct;
-  
-  int blocklens[1]={5};
-  MPI_Datatype old_types[1] = {MPI_DOUBLE}; 
-  MPI_Aint displacements[1];
-  displacements[0] 	= offsetof(bounds, lower_upper);
-  MPI_Type_create_struct( 1, blocklens, displacements, old_types, &mystruct );
-
-  
-  MPI_Type_commit( &mystruct );
   int NN = 0;
   
   if (rank == 0){
@@ -86,19 +79,25 @@ int MPI_comm::gather_all_bidir_predicitions(vector<segment *> all,
       if (start >= stop){
 	start 	= stop;
       }
-      
-      
-      
-      for (int i = 0; i < (stop-start) ; i++){
-	MPI_Recv(&S, 1, MPI_INT, j, i, MPI_COMM_WORLD,MPI_STATUS_IGNORE);
-	NN+=S;	
+      int SN 	= 0, BN = 0;
+      MPI_Recv(&SN, 1, MPI_INT, j, 0, MPI_COMM_WORLD,MPI_STATUS_IGNORE);
+      MPI_Recv(&BN, 1, MPI_INT, j, 1, MPI_COMM_WORLD,MPI_STATUS_IGNORE);
+      vector<int> S(SN);
+      vector<double> B(BN);
+      if (SN){
+	MPI_Recv(&S[0], SN, MPI_INT, j, 2, MPI_COMM_WORLD,MPI_STATUS_IGNORE);
+      }
+      if (BN){
+	MPI_Recv(&B[0], BN, MPI_DOUBLE, j, 3, MPI_COMM_WORLD,MPI_STATUS_IGNORE);
+      }
+      int b 	= 0;
+      for (int i = 0; i < SN and i < (stop-start) ; i++){
+	NN+=S[i];	
        
-	G[all[ start+i ]->chrom] 	= vector<vector<double> >(S);
-	for (int u = 0; u < S; u++ ){
-	  MPI_Recv(&B, 1, mystruct, j, u, MPI_COMM_WORLD,MPI_STATUS_IGNORE);				  
-	  for (int l = 0 ; l < 5;l++){
-	    G[all[ start+i ]->chrom][u].push_back(B.lower_upper[l]);
-	  }
+	G[all[ start+i ]->chrom] 	= vector<vector<double> >(S[i]);
+	for (int u = 0; u < S[i]; u++ ){
+	  G[all[ start+i ]->chrom][u] 	= vector<double>(B.begin() + b, B.begin() + b + 5);
+	  b+=5;
 	}
       }
       
@@ -108,24 +107,24 @@ int MPI_comm::gather_all_bidir_predicitions(vector<segment *> all,
     
   }else  {
    
-    int IS = segments.size();
+    vector<int> S;
+    vector<double> B;
     for (int i = 0;  i < segments.size();i++ ){
-      int S 	= segments[i]->bidirectional_bounds.size();
-      
-      MPI_Ssend(&S, 1, MPI_INT, 0,i,MPI_COMM_WORLD );
-      
+      S.push_back(segments[i]->bidirectional_bounds.size());
       for (int u=0; u < segments[i]->bidirectional_bounds.size(); u++){				
-	bounds B;
-	
 	for (int l = 0 ; l < 5; l++){
-	  B.lower_upper[l] = segments[i]->bidirectional_bounds[u][l];
+	  B.push_back(segments[i]->bidirectional_bounds[u][l]);
 	}
-	
-	
-	MPI_Send(&B, 1, mystruct, 0, u, MPI_COMM_WORLD);
-	
       }
-      
+    }
+    int SN 	= S.size(), BN = B.size();
+    MPI_Ssend(&SN, 1, MPI_INT, 0,0,MPI_COMM_WORLD );
+    MPI_Ssend(&BN, 1, MPI_INT, 0,1,MPI_COMM_WORLD );
+    if (SN){
+      MPI_Ssend(&S[0], SN, MPI_INT, 0,2,MPI_COMM_WORLD );
+    }
+    if (BN){
+      MPI_Ssend(&B[0], BN, MPI_DOUBLE, 0,3,MPI_COMM_WORLD );
     }
     
     
@@ -141,11 +140,43 @@ int MPI_comm::gather_all_bidir_predicitions(vector<segment *> all,
 
 
 struct simple_seg_struct{
-	char chrom[6];
+	int chrom_ID; //CONTIGS
 	char strand[2];
 	int st_sp[4]; //first->start, second->stop
 };
 
+//every rank gets the contig table of rank 0, names joined by newlines
+void MPI_comm::send_out_contigs(int rank, int nprocs){
+	string joined;
+	int n 	= 0;
+	if (rank==0){
+		for (int i = 0; i < CONTIGS.names.size(); i++){
+			joined+=CONTIGS.names[i] + "\n";
+		}
+		n 	= joined.size();
+		for (int j = 1 ; j < nprocs;j++){
+			MPI_Ssend(&n, 1, MPI_INT, j, 0, MPI_COMM_WORLD);
+			if (n){
+				MPI_Ssend(&joined[0], n, MPI_CHAR, j, 1, MPI_COMM_WORLD);
+			}
+		}
+	}else{
+		MPI_Recv(&n, 1, MPI_INT, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+		joined.resize(n);
+		if (n){
+			MPI_Recv(&joined[0], n, MPI_CHAR, 0, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+		}
+		CONTIGS 	= contig_dictionary();
+		int b 	= 0;
+		for (int i = 0; i < n; i++){
+			if (joined[i]=='\n'){
+				CONTIGS.intern(joined.substr(b, i-b));
+				b 	= i+1;
+			}
+		}
+	}
+}
+
 
 map<string, vector<segment *> > MPI_comm::send_out_single_fit_assignments(vector<segment *> FSI, int rank, int nprocs ){
 	map<string, vector<segment *> > GG;
@@ -157,10 +188,10 @@ map<string, vector<segment *> > MPI_comm::send_out_single_fit_assignments(vector
 	simple_seg_struct sss;
 	MPI_Datatype mystruct;
 	
-	int blocklens[3]={6,2,4};
-	MPI_Datatype old_types[3] = {MPI_CHAR,MPI_CHAR, MPI_INT}; 
+	int blocklens[3]={1,2,4};
+	MPI_Datatype old_types[3] = {MPI_INT,MPI_CHAR, MPI_INT}; 
 	MPI_Aint displacements[3];
-	displacements[0] 	= offsetof(simple_seg_struct, chrom);
+	displacements[0] 	= offsetof(simple_seg_struct, chrom_ID);
 	displacements[1] 	= offsetof(simple_seg_struct, strand);
 	displacements[2] 	= offsetof(simple_seg_struct, st_sp);
 	
@@ -171,6 +202,12 @@ map<string, vector<segment *> > MPI_comm::send_out_single_fit_assignments(vector
 	vector<simple_seg_struct> runs;
 	int start, stop;
 	int S;
+	if (rank == 0){
+		for (int i = 0; i < N; i++){
+			CONTIGS.intern(FSI[i]->chrom);
+		}
+	}
+	send_out_contigs(rank, nprocs);
 	if (rank == 0){
 		//first send out the number you are going to send
 		for (int j =0; j < nprocs; j++){
@@ -191,14 +228,7 @@ map<string, vector<segment *> > MPI_comm::send_out_single_fit_assignments(vector
 			int u 	= 0;
 			for (int i =start; i< stop; i++){
 				simple_seg_struct SSS;
-				for (int c = 0; c < 6; c++){
-					if (c <FSI[i]->chrom.size() ){
-						SSS.chrom[c] 	= FSI[i]->chrom[c];
-					}else{
-						SSS.chrom[c] 	= '\0';
-					}
-				}
-				SSS.chrom[5]	= '\0';
+				SSS.chrom_ID 	= CONTIGS.find(FSI[i]->chrom);
 				SSS.strand[0] 	= FSI[i]->strand[0];
 				SSS.strand[1] 	= '\0';
 				SSS.st_sp[0] 	= FSI[i]->start;
@@ -206,7 +236,7 @@ map<string, vector<segment *> > MPI_comm::send_out_single_fit_assignments(vector
 				SSS.st_sp[2] 	= FSI[i]->ID;
 				SSS.st_sp[3] 	= FSI[i]->counts;
 				if (j >0){
-					MPI_Send(&SSS, 2, mystruct, j, u, MPI_COMM_WORLD  );
+					MPI_Send(&SSS, 1, mystruct, j, u, MPI_COMM_WORLD  );
 				}else{
 					runs.push_back(SSS);
 				}
@@ -217,13 +247,14 @@ map<string, vector<segment *> > MPI_comm::send_out_single_fit_assignments(vector
 	}else{
 		MPI_Recv(&S, 1, MPI_INT, 0, 1, MPI_COMM_WORLD,MPI_STATUS_IGNORE);
 		for (int u = 0; u < S; u++){
-			MPI_Recv(&sss, 2, mystruct, 0,u,MPI_COMM_WORLD, MPI_STATUS_IGNORE);	
+			MPI_Recv(&sss, 1, mystruct, 0,u,MPI_COMM_WORLD, MPI_STATUS_IGNORE);	
 			runs.push_back(sss);
 		}	
 	}
 	//now convert to GG type
 	for (int i = 0; i < runs.size(); i++){
-		segment * ns 	= new segment(runs[i].chrom, runs[i].st_sp[0], runs[i].st_sp[1], runs[i].st_sp[2], runs[i].strand);
+		segment * ns 	= new segment(CONTIGS.name(runs[i].chrom_ID), runs[i].st_sp[0], runs[i].st_sp[1], runs[i].st_sp[2], runs[i].strand);
+		ns->chrom_ID 	= runs[i].chrom_ID;
 		ns->counts 		= runs[i].st_sp[3];
 		GG[ns->chrom].push_back(ns) ;
 	}
@@ -235,6 +266,27 @@ map<string, vector<segment *> > MPI_comm::send_out_single_fit_assignments(vector
 }
 
 
+//broadcasts rank 0's N
+int MPI_comm::send_out_count(int N, int rank, int nprocs){
+	if (rank==0){
+		for (int j = 1 ; j < nprocs;j++){
+			MPI_Ssend(&N, 1, MPI_INT, j, 0, MPI_COMM_WORLD);
+		}
+	}else{
+		MPI_Recv(&N, 1, MPI_INT, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+	}
+	return N;
+}
+
+//1 on every rank if flag is set on any of them
+int MPI_comm::any_rank(int flag, int rank, int nprocs){
+	int any 	= flag;
+	if (nprocs > 1){
+		MPI_Allreduce(&flag, &any, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+	}
+	return any;
+}
+
 vector<double> MPI_comm::send_out_parameters(vector<double> parameters, int rank, int nprocs){
 	vector<double> new_parameters;
 	double * P 	= new double[5];
@@ -336,12 +388,12 @@ map<int, map<int, vector<simple_c_free_mode>  > > MPI_comm::gather_all_simple_c_
 	simple_c_free_mode sc_fm;
 	MPI_Datatype mystruct;
 	
-	int blocklens[4]={3,5, 6, 12};
-	MPI_Datatype old_types[4] = {MPI_DOUBLE, MPI_INT, MPI_CHAR, MPI_DOUBLE}; 
+	int blocklens[4]={3,5, 1, 12};
+	MPI_Datatype old_types[4] = {MPI_DOUBLE, MPI_INT, MPI_INT, MPI_DOUBLE}; 
 	MPI_Aint displacements[4];
 	displacements[0] 	= offsetof(simple_c_free_mode, SS);
 	displacements[1] 	= offsetof(simple_c_free_mode, ID);
-	displacements[2] 	= offsetof(simple_c_free_mode, chrom);
+	displacements[2] 	= offsetof(simple_c_free_mode, chrom_ID);
 	displacements[3] 	= offsetof(simple_c_free_mode, ps);
 	
 	
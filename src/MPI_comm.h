@@ -15,6 +15,9 @@ vector<segment *> slice_segments(vector<segment *>, int , int );
 
 int gather_all_bidir_predicitions(vector<segment *> ,
 vector<segment *>, int, int,string, string, int, params *, int );
+int gather_all_bidir_predicitions(vector<segment *> ,
+vector<segment *>, int, int,string, string, int, params *, int,
+map<string , vector<vector<double> > > & );
 
 
 map<string, vector<segment *> > send_out_single_fit_assignments(vector<segment *> , int, int);
@@ -29,6 +32,9 @@ map<int, map<int, vector<simple_c_free_mode>  > >  gather_all_simple_c_free_mode
 void wait_on_root(int, int);
 
 vector<double> send_out_parameters(vector<double> , int , int );
+int send_out_count(int, int, int);
+int any_rank(int, int, int);
+void send_out_contigs(int, int);
 
 map<string, vector<segment *> >  convert_segment_vector(vector<segment *> );
 }
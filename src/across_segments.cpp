@@ -63,14 +63,7 @@ simple_c_free_mode::simple_c_free_mode(bool FOUND, double ll,
 	}else{
 		ID[4]=0;//didn't converge
 	}
-	for (int c =0 ; c < 5; c++){
-		if (c < data->chrom.size()){
-			chrom[c]=data->chrom[c];
-		}else{
-			chrom[c]='\0';
-		}
-	}
-	chrom[5]='\0';
+	chrom_ID 	= CONTIGS.find(data->chrom);
 	if (not FOUND){
 		for (int i = 0; i < 12; i++ ){
 			ps[i] 	= 0;
@@ -104,8 +97,8 @@ map<int, vector<simple_c_free_mode> > get_max_from_free_mode(map<int, vector<cla
 	//get forward and reverse N
 	double forward_N =0, reverse_N=0;
 	for (int i  = 0 ; i < data->XN;i++){
-		forward_N+=data->X[1][i];
-		reverse_N+=data->X[2][i];
+		forward_N+=data->X.fwd[i];
+		reverse_N+=data->X.rev[i];
 	}
 
 
@@ -192,26 +185,31 @@ vector<double> compute_average_model(vector<segment *> segments, params * P){
 		printf("\nStrange Error in across_segments::compute_average_model\nIgnoring but please consult tFIT contact info\nThank You\n");
 	}
 	int XN 			= maxX/delta;
-	double ** X 	= new double*[3];
+	segment * s 	= new segment("chrX", 0, maxX );
+	s->X.allocate(XN);
+	s->minX=minX, s->maxX =maxX;
+	s->XN 			= XN;
+	s->SCALE 		= stod(P->p["-ns"]);
+	coverage_block & X 	= s->X;
 	double x 		= 0;
-	X[0] 	= new double[XN],X[1] 	= new double[XN],X[2] 	= new double[XN];
 	for (int i = 0 ; i < XN;i++){
-		X[0][i] 		= x,X[1][i] 		= 0,X[2][i] 		= 0 ;
+		X.pos[i] 		= x,X.fwd[i] 		= 0,X.rev[i] 		= 0 ;
 		x+=delta;
 	}
-	for (int s = 0 ; s < segments.size(); s++){
+	for (int t = 0 ; t < segments.size(); t++){
 		double N 	= 0;
 		int j 		= 0;
-		if (segments[s]->rN > 1 and segments[s]->fN > 1){
-			for (int i = 0 ; i < segments[s]->XN; i++){
-				while (j < XN and X[0][j] < segments[s]->X[0][i]){
+		if (segments[t]->rN > 1 and segments[t]->fN > 1){
+			coverage_view Y = segments[t]->view();
+			for (int i = 0 ; i < segments[t]->XN; i++){
+				while (j < XN and X.pos[j] < Y.x(i)){
 					j++;
 				}
 				if (j < XN){
-					X[1][j]+=(segments[s]->X[1][i]/segments[s]->fN);
-					X[2][j]+=(segments[s]->X[2][i]/segments[s]->rN);
+					X.fwd[j]+=(segments[t]->X.fwd[i]/segments[t]->fN);
+					X.rev[j]+=(segments[t]->X.rev[i]/segments[t]->rN);
 				}
-				N+=(segments[s]->X[1][i] + segments[s]->X[2][i] );
+				N+=(segments[t]->X.fwd[i] + segments[t]->X.rev[i] );
 			}
 		}
 	}
@@ -222,17 +220,13 @@ vector<double> compute_average_model(vector<segment *> segments, params * P){
 				stod(P->p["-r_mu"]), 10.0, 10.0, 1.0, 
 				1.0*segments.size(), 2*segments.size() , stod(P->p["-ALPHA_3"]),0 );
 		vector<double> centers 	= {10};
-		segment * s 			= new segment("chrX", 0, maxX );
-		s->X 					= X;
-		s->minX=minX, s->maxX =maxX;
-		s->XN 					= XN;
-		s->SCALE 				= stod(P->p["-ns"]);
 		clf.fit2(s,centers, 0,0);
 		if (clf.ll > ll){
 			ll 			= clf.ll;
 			best_clf 	= clf; 
 		}
 	}	
+	delete s;
 
 
 	vector<double> parameters(5);
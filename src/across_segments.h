@@ -31,14 +31,14 @@ struct simple_c{
 struct simple_c_free_mode{
 	double SS[3];	//log-likelihood, N_forward, N_reverse
 	int ID[5] ;  //index of the segment that this belongs,start, stop, converged?
-	char chrom[6];
+	int chrom_ID; //CONTIGS
 	double ps[12]; //parameters for the component
 	simple_c_free_mode(bool , double, component ,
 		int, segment *, int, double, double);
 	simple_c_free_mode();
 };
 struct single_simple_c{
-	char chrom[6];
+	int chrom_ID;
 	int st_sp[3];
 	double ps[10];
 };
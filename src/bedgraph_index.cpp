@@ -0,0 +1,113 @@
+#include "bedgraph_index.h"
+#include "mmap_reader.h"
+#include <fstream>
+#include <cstring>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace std;
+
+static const string BEDGRAPH_INDEX_MAGIC = "#TFIT_INDEX";
+
+string bedgraph_index_path(string FILE) {
+	return FILE + ".tfi";
+}
+
+bool stat_bedgraph(string FILE, long & size, long & mtime, int & mtime_ns) {
+	struct stat st;
+	if (stat(FILE.c_str(), &st) != 0 or not S_ISREG(st.st_mode)) {
+		return false;
+	}
+	size  = st.st_size, mtime = st.st_mtim.tv_sec, mtime_ns = st.st_mtim.tv_nsec;
+	return true;
+}
+
+bedgraph_index::bedgraph_index() {
+	size  = -1, mtime = -1, mtime_ns = -1, lines = 0;
+}
+
+//only looks at the first field of each line; false if compressed input is damaged
+bool bedgraph_index::build(mapped_file * MF) {
+	entries.clear();
+	lines = 0;
+	text_reader R(MF);
+	line_scanner L(&R);
+	while (L.next()) {
+		const char * tab  = (const char *)memchr(L.line, '\t', L.line_end - L.line);
+		int k             = (tab == NULL ? L.line_end : tab) - L.line;
+		if (entries.empty() or k != entries.back().chrom.size()
+		        or memcmp(L.line, entries.back().chrom.data(), k) != 0) {
+			if (not entries.empty()) {
+				entries.back().end  = L.offset();
+			}
+			bedgraph_index_entry E;
+			E.chrom   = string(L.line, k);
+			E.begin   = L.offset(), E.end = E.begin;
+			E.line    = lines;
+			entries.push_back(E);
+		}
+		lines++;
+	}
+	if (not entries.empty()) {
+		entries.back().end  = R.tell();
+	}
+	return not MF->corrupt;
+}
+
+bool bedgraph_index::read(string FILE) {
+	mapped_file MF;
+	if (not MF.open(bedgraph_index_path(FILE))) {
+		return false;
+	}
+	line_scanner L(MF.data, MF.data + MF.size);
+	text_field F[5];
+	int lb, le;
+	double s, m;
+	if (not L.next() or L.split('\t', F, 5) != 5 or not F[0].equals(BEDGRAPH_INDEX_MAGIC)
+	        or not parse_double(F[1], s) or not parse_double(F[2], m) or not parse_int(F[3], mtime_ns)
+	        or not parse_int(F[4], lines)) {
+		return false;
+	}
+	size  = s, mtime = m;
+	entries.clear();
+	while (L.next()) {
+		bedgraph_index_entry E;
+		double b, e;
+		if (L.split('\t', F, 4) != 4 or not parse_double(F[1], b) or not parse_double(F[2], e)
+		        or not parse_int(F[3], E.line)) {
+			entries.clear();
+			return false;
+		}
+		E.chrom = F[0].str(), E.begin = b, E.end = e;
+		entries.push_back(E);
+	}
+	return true;
+}
+
+//true if the index was made from FILE as it is now
+bool bedgraph_index::current(string FILE) {
+	long s, m;
+	int ns;
+	return stat_bedgraph(FILE, s, m, ns) and s == size and m == mtime and ns == mtime_ns;
+}
+
+//written to a temporary and renamed, so concurrent jobs never see half an index;
+//false if FILE's directory can't be written to
+bool bedgraph_index::write(string FILE) {
+	string OUT  = bedgraph_index_path(FILE);
+	string TMP  = OUT + "." + to_string(getpid());
+	ofstream FHW(TMP);
+	if (not FHW) {
+		return false;
+	}
+	FHW << BEDGRAPH_INDEX_MAGIC << "\t" << size << "\t" << mtime << "\t" << mtime_ns << "\t" << lines << endl;
+	for (int i = 0; i < entries.size(); i++) {
+		FHW << entries[i].chrom << "\t" << entries[i].begin << "\t" << entries[i].end << "\t" << entries[i].line << endl;
+	}
+	FHW.close();
+	if (not FHW or rename(TMP.c_str(), OUT.c_str()) != 0) {
+		remove(TMP.c_str());
+		return false;
+	}
+	return true;
+}
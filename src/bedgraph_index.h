@@ -0,0 +1,42 @@
+#ifndef bedgraph_index_H
+#define bedgraph_index_H
+#include <string>
+#include <vector>
+#include <cstddef>
+using namespace std;
+
+class mapped_file;
+
+//where each chromosome sits in a bedgraph file, kept next to it as FILE.tfi
+//
+//#TFIT_INDEX[tab]file size[tab]file mtime (s)[tab]and its ns[tab]number of lines
+//chromosome[tab]first byte[tab]last byte + 1[tab]line number of the first line
+//
+//one row per run of consecutive lines of a chromosome (more than one row per
+//chromosome when the file isn't sorted), offsets are into the inflated text for
+//gzip/BGZF files. The size and mtime (to the nanosecond where the filesystem
+//keeps it) tell a stale index apart.
+
+class bedgraph_index_entry{
+public:
+	string chrom;
+	long begin, end;
+	int line;
+};
+
+class bedgraph_index{
+public:
+	long size, mtime;
+	int mtime_ns, lines;
+	vector<bedgraph_index_entry> entries;
+	bedgraph_index();
+	bool build(mapped_file *);
+	bool read(string);
+	bool write(string);
+	bool current(string);
+};
+
+string bedgraph_index_path(string);
+bool stat_bedgraph(string, long &, long &, int &);
+
+#endif
@@ -9,6 +9,7 @@
 #include "error_stdo_logging.h"
 #include "FDR.h"
 #include "BIC.h"
+#include "binned_cache.h"
 using namespace std;
 int bidir_run(params * P, int rank, int nprocs, int job_ID, Log_File * LG){
 
@@ -41,6 +42,62 @@ int bidir_run(params * P, int rank, int nprocs, int job_ID, Log_File * LG){
 	map<string, int> chrom_to_ID;
 	map<int, string> ID_to_chrom;
        
+	//with -tile the chromosomes are only named here, template matching reads them
+	//a window at a time. Without -tile they are read one by one while the one
+	//before is scanned, unless -FDR, -tss or -MLE need all of them in memory at
+	//once or -mem_budget spills them (bigWig and .tfb input are always loaded whole)
+	vector<segment *> 	segments;
+	bedgraph_tiles tiles;
+	vector<string> FILES 	= {joint_bedgraph};
+	if (joint_bedgraph.empty()){
+		FILES 	= {forward_bedgraph, reverse_bedgraph};
+	}
+	bool genome_wide 	= stoi(P->p["-FDR"]) or not tss_file.empty() or stoi(P->p["-MLE"])
+		or stoi(P->p["-mem_budget"]) > 0;
+	//the halo is -pad plus two bins: the scan needs a bin past each window and the
+	//last bin of a segment never receives coverage
+	bool streamed 		= (stoi(P->p["-tile"]) > 0 or not genome_wide) and tiles.open(FILES, P->p["-chr"],
+		stoi(P->p["-br"]), stof(P->p["-ns"]), stoi(P->p["-tile"]), stoi(P->p["-pad"]) + 2 * stoi(P->p["-br"]));
+	bool tiled 		= streamed and stoi(P->p["-tile"]) > 0;
+	if (tiled and stoi(P->p["-mem_budget"]) > 0){
+		LG->write("-mem_budget is ignored with -tile, a window at a time is in memory\n", verbose);
+	}
+	if (streamed){
+		LG->write(tiled ? "indexing bedgraph files (-tile)........................."
+			: "indexing bedgraph files.................................", verbose);
+		vector<string> chroms 	= tiles.chromosomes();
+		for (int c = 0; c < chroms.size(); c++){
+			segment * S 	= new segment(chroms[c], 0, 0);
+			S->chrom_ID 	= CONTIGS.intern(S->chrom);
+			chrom_to_ID[S->chrom] 		= S->chrom_ID;
+			ID_to_chrom[S->chrom_ID] 	= S->chrom;
+			segments.push_back(S);
+		}
+	}else{
+		//-mem_budget: coverage past the budget is kept in a scratch file instead
+		coverage_spill spill;
+		coverage_spill * S 	= NULL;
+		if (stoi(P->p["-mem_budget"]) > 0 and spill.open(out_file_dir + job_name + "-" + to_string(job_ID)
+				+ "_" + to_string(rank) + ".spill", stod(P->p["-mem_budget"]) * 1024 * 1024)){
+			S 	= &spill;
+		}
+		LG->write("loading bedgraph files..................................", verbose);
+		segments 	= load::load_bedgraphs_total(forward_bedgraph, reverse_bedgraph, joint_bedgraph,
+			stoi(P->p["-br"]), stof(P->p["-ns"]), P->p["-chr"], chrom_to_ID, ID_to_chrom, S );
+		if (S != NULL and not S->map()){
+			segments.clear();
+		}
+		if (S != NULL and S->spilled > 0){
+			LG->write("(" + to_string(int(S->spilled / (1024 * 1024))) + " MB spilled to disk)...", verbose);
+		}
+	}
+
+	if (segments.empty()){
+		printf("exiting...\n");
+		return 1;
+	}
+	LG->write("done\n", verbose);
+
 	vector<double> parameters 	= {sigma, lambda, foot_print,pi, w};
 	if (not tss_file.empty() and rank == 0){
 		vector<segment *> FSI;
@@ -52,8 +109,15 @@ int bidir_run(params * P, int rank, int nprocs, int job_ID, Log_File * LG){
 		LG->write("done\n", verbose);
 		
 		LG->write("inserting coverage data.................................",verbose);
-		vector<segment*> integrated_segments= load::insert_bedgraph_to_segment_joint(GG, 
-			forward_bedgraph, reverse_bedgraph, joint_bedgraph, rank);
+		//the TSS windows come out of the genome wide bins already in memory, unless
+		//-chr left out the other chromosomes or -tile never loaded them
+		vector<segment*> integrated_segments;
+		if (P->p["-chr"] == "all" and not tiled){
+			integrated_segments 	= load::insert_binned_segments(GG, segments, stoi(P->p["-br"]));
+		}else{
+			integrated_segments 	= load::insert_bedgraph_to_segment_joint(GG, 
+				forward_bedgraph, reverse_bedgraph, joint_bedgraph, rank, stoi(P->p["-br"]), stof(P->p["-ns"]));
+		}
 		LG->write("done\n", verbose);
 
 		LG->write("Binning/Normalizing TSS intervals.......................",verbose);
@@ -70,6 +134,7 @@ int bidir_run(params * P, int rank, int nprocs, int job_ID, Log_File * LG){
 		LG->write("-foot_print : " + to_string(parameters[2])+ "\n", verbose);
 		LG->write("-pi         : " + to_string(parameters[3])+ "\n", verbose);
 		LG->write("-w          : " + to_string(parameters[4])+ "\n\n", verbose);
+		load::clear_segments(integrated_segments);
 	}
 	parameters 				= MPI_comm::send_out_parameters( parameters, rank, nprocs);
 	P->p["-sigma"] 	       = to_string(parameters[0]);
@@ -78,21 +143,15 @@ int bidir_run(params * P, int rank, int nprocs, int job_ID, Log_File * LG){
 	P->p["-pi"] 	       = to_string(parameters[3]);
 	P->p["-w"] 	       = to_string(parameters[4]);
 
-	LG->write("loading bedgraph files..................................", verbose);
-	vector<segment *> 	segments 	= load::load_bedgraphs_total(forward_bedgraph, reverse_bedgraph, joint_bedgraph,
-		stoi(P->p["-br"]), stof(P->p["-ns"]), P->p["-chr"], chrom_to_ID, ID_to_chrom );
-
-	if (segments.empty()){
-		printf("exiting...\n");
-		return 1;
-	}
-	LG->write("done\n", verbose);
 
 
 
 
 	slice_ratio SC;
-	if (stoi(P->p["-FDR"] ) ){
+	if (stoi(P->p["-FDR"] ) and tiled){
+	  LG->write("-FDR needs whole chromosomes, ignored with -tile\n", verbose);
+	}
+	if (stoi(P->p["-FDR"] ) and not tiled){
 	  LG->write("getting likelihood score distribution...................", verbose);
 	  SC                      = get_slice(segments, pow(10,6) , pow(10,4) ,P  );
 	  LG->write("done\n\n", verbose);
@@ -128,15 +187,29 @@ int bidir_run(params * P, int rank, int nprocs, int job_ID, Log_File * LG){
 	//(3a) now going to run the template matching algorithm based on pseudo-
 	//moment estimator and compute BIC ratio (basically penalized LLR)
 	LG->write("running template matching algorithm.....................", verbose);
-	double threshold 	= run_global_template_matching(segments, out_file_dir, P, SC);	
+	double threshold;
+	if (tiled){
+		threshold 	= run_tiled_template_matching(tiles, segments, P, SC, LG);
+	}else if (streamed){
+		threshold 	= run_pipelined_template_matching(tiles, segments, P, SC, LG);
+	}else{
+		threshold 	= run_global_template_matching(segments, out_file_dir, P, SC, LG);
+	}	
+	//a line that isn't bedgraph stops the run like it does when everything is
+	//loaded up front, on every MPI process
+	if (MPI_comm::any_rank(streamed and tiles.bad_line >= 0, rank, nprocs)){
+		printf("exiting...\n");
+		return 1;
+	}
 	//(3b) now need to send out, gather and write bidirectional intervals 
 	LG->write("done\n", verbose);
 	
 
 
 	LG->write("scattering predictions to other MPI processes...........", verbose);
+	map<string , vector<vector<double> > > G;
 	int total =  MPI_comm::gather_all_bidir_predicitions(all_segments, 
-							     segments , rank, nprocs, out_file_dir, job_name, job_ID,P,0);
+							     segments , rank, nprocs, out_file_dir, job_name, job_ID,P,0, G);
 	MPI_Barrier(MPI_COMM_WORLD); //make sure everybody is caught up!
 
 	LG->write("done\n", verbose);
@@ -145,18 +218,28 @@ int bidir_run(params * P, int rank, int nprocs, int job_ID, Log_File * LG){
 	}
 	
 	//===========================================================================
-	//this should conclude it all
-	LG->write("clearing allocated segment memory.......................", verbose);	
-	load::clear_segments(all_segments);
-	LG->write("done\n", verbose);
-	//===========================================================================
-	//(4) if MLE option was provided than need to run the model_main::run()
+	//(4) if MLE option was provided than need to run the model_main::run(), the
+	//predictions and the binned coverage are handed over as they are
 	//
 	if (stoi(P->p["-MLE"])){
 		P->p["-k"] 	= P->p["-o"]+ job_name+ "-" + to_string(job_ID)+ "_prelim_bidir_hits.bed";
-		model_run(P, rank, nprocs,0, job_ID, LG);
-		
+		map<int, string> IDS;
+		vector<segment *> FSI;
+		if (rank == 0){
+			FSI 	= load::intervals_from_bidirs(G, IDS, P);
+		}
+		if (MPI_comm::send_out_count(FSI.size(), rank, nprocs)){
+			LG->write("\ninitializing model module...............................done\n\n",verbose);
+			model_run(P, rank, nprocs,0, job_ID, LG, FSI, IDS, tiled ? vector<segment *>() : all_segments);
+		}else if (rank == 0){
+			printf("no bidirectional predictions to model\n");
+		}
 	}
+	//===========================================================================
+	//this should conclude it all
+	LG->write("clearing allocated segment memory.......................", verbose);	
+	load::clear_segments(all_segments);
+	LG->write("done\n", verbose);
 	LG->write("exiting bidir module....................................done\n\n", verbose);
 	return 1;
 }
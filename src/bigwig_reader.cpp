@@ -0,0 +1,187 @@
+#include "bigwig_reader.h"
+#include <fstream>
+#include <cstring>
+#include <stdio.h>
+#include <algorithm>
+#include <zlib.h>
+using namespace std;
+
+static const unsigned int BIGWIG_MAGIC    = 0x888FFC26;
+static const unsigned int BPT_MAGIC       = 0x78CA8C91;
+static const unsigned int RTREE_MAGIC     = 0x2468ACE0;
+static const int MAX_TREE_DEPTH           = 16; //both trees are a few levels deep
+
+template <typename T> T get(const char * p) {
+	T x;
+	memcpy(&x, p, sizeof(T));
+	return x;
+}
+
+bool is_bigwig(string FILE) {
+	char magic[4];
+	ifstream FH(FILE, ios::binary);
+	if (not FH or not FH.read(magic, 4)) {
+		return false;
+	}
+	return get<unsigned int>(magic) == BIGWIG_MAGIC;
+}
+
+//walks the chromosome B+ tree and keeps every leaf; children are written after
+//their parent, so an offset that points back (a loop) or a tree deeper than
+//MAX_TREE_DEPTH is corrupt
+bool read_chrom_tree(const char * data, size_t size, long node, int key_size,
+                     map<string, int> & ID, map<string, int> & sizes, int depth) {
+	if (node + 4 > size or depth > MAX_TREE_DEPTH) {
+		return false;
+	}
+	int leaf    = data[node];
+	int count   = get<unsigned short>(data + node + 2);
+	const char * p  = data + node + 4;
+	for (int i = 0; i < count; i++) {
+		if (p + key_size + 8 > data + size) {
+			return false;
+		}
+		string key(p, strnlen(p, key_size));
+		if (leaf) {
+			ID[key]     = get<unsigned int>(p + key_size);
+			sizes[key]  = get<unsigned int>(p + key_size + 4);
+		} else {
+			long child  = get<unsigned long>(p + key_size);
+			if (child <= node or not read_chrom_tree(data, size, child, key_size, ID, sizes, depth + 1)) {
+				return false;
+			}
+		}
+		p += key_size + 8;
+	}
+	return true;
+}
+
+bool bigwig_file::open(string FILE) {
+	if (not MF.open(FILE) or MF.size < 64 or get<unsigned int>(MF.data) != BIGWIG_MAGIC) {
+		printf("%s is not a (little endian) bigWig file\n", FILE.c_str());
+		return false;
+	}
+	long chrom_tree   = get<unsigned long>(MF.data + 8);
+	index_offset      = get<unsigned long>(MF.data + 24);
+	uncompress_buf    = get<unsigned int>(MF.data + 52);
+	if (chrom_tree + 32 > MF.size or get<unsigned int>(MF.data + chrom_tree) != BPT_MAGIC
+	        or index_offset + 48 > MF.size or get<unsigned int>(MF.data + index_offset) != RTREE_MAGIC) {
+		printf("%s has a corrupt header\n", FILE.c_str());
+		return false;
+	}
+	int key_size  = get<unsigned int>(MF.data + chrom_tree + 8);
+	if (not read_chrom_tree(MF.data, MF.size, chrom_tree + 32, key_size, chrom_ID, chrom_size, 0)) {
+		printf("%s has a corrupt chromosome index\n", FILE.c_str());
+		return false;
+	}
+	return true;
+}
+
+//(chrom, base) pairs compared lexicographically
+bool before(unsigned int c1, unsigned int b1, unsigned int c2, unsigned int b2) {
+	return c1 < c2 or (c1 == c2 and b1 < b2);
+}
+
+//same guards as read_chrom_tree, a corrupt index only loses blocks
+void search_rtree(const char * data, size_t size, long node, unsigned int cid, int start, int stop,
+                  vector<pair<long, long> > & blocks, int depth) {
+	if (node + 4 > size or depth > MAX_TREE_DEPTH) {
+		return;
+	}
+	int leaf    = data[node];
+	int count   = get<unsigned short>(data + node + 2);
+	const char * p  = data + node + 4;
+	for (int i = 0; i < count; i++) {
+		unsigned int sc = get<unsigned int>(p), sb = get<unsigned int>(p + 4);
+		unsigned int ec = get<unsigned int>(p + 8), eb = get<unsigned int>(p + 12);
+		if (before(sc, sb, cid, stop) and before(cid, start, ec, eb)) {
+			if (leaf) {
+				blocks.push_back(make_pair(get<unsigned long>(p + 16), get<unsigned long>(p + 24)));
+			} else if (long(get<unsigned long>(p + 16)) > node) {
+				search_rtree(data, size, get<unsigned long>(p + 16), cid, start, stop, blocks, depth + 1);
+			}
+		}
+		p += leaf ? 32 : 24;
+	}
+}
+
+//coverage of chrom overlapping any of the [start, stop) regions (sorted, not
+//overlapping), in file order
+bool bigwig_file::read(string chrom, vector<vector<int> > regions, vector<coverage_run> & out) {
+	map<string, int>::const_iterator id  = chrom_ID.find(chrom);
+	if (id == chrom_ID.end()) {
+		return true;
+	}
+	unsigned int cid  = id->second;
+	vector<pair<long, long> > blocks;
+	for (int r = 0; r < regions.size(); r++) {
+		search_rtree(MF.data, MF.size, index_offset + 48, cid, regions[r][0], regions[r][1], blocks, 0);
+	}
+	sort(blocks.begin(), blocks.end());
+	blocks.erase(unique(blocks.begin(), blocks.end()), blocks.end());
+
+	vector<char> buf(max(uncompress_buf, 1u));
+	for (int b = 0; b < blocks.size(); b++) {
+		if (blocks[b].first + blocks[b].second > MF.size) {
+			return false;
+		}
+		const char * d  = MF.data + blocks[b].first;
+		long n          = blocks[b].second;
+		if (uncompress_buf) {
+			uLongf len  = buf.size();
+			if (uncompress((Bytef *)buf.data(), &len, (const Bytef *)d, n) != Z_OK) {
+				return false;
+			}
+			d   = buf.data(), n = len;
+		}
+		if (n < 24) {
+			return false;
+		}
+		unsigned int sid    = get<unsigned int>(d);
+		unsigned int sstart = get<unsigned int>(d + 4);
+		unsigned int step   = get<unsigned int>(d + 12), span = get<unsigned int>(d + 16);
+		int type            = d[20];
+		int count           = get<unsigned short>(d + 22);
+		int width           = (type == 1) ? 12 : (type == 2 ? 8 : 4);
+		if (sid != cid or 24 + long(count) * width > n) {
+			continue;
+		}
+		const char * p  = d + 24;
+		for (int i = 0; i < count; i++, p += width) {
+			int st, sp;
+			float y;
+			if (type == 1) {
+				st  = get<unsigned int>(p), sp = get<unsigned int>(p + 4), y = get<float>(p + 8);
+			} else if (type == 2) {
+				st  = get<unsigned int>(p), sp = st + span, y = get<float>(p + 4);
+			} else {
+				st  = sstart + i * step, sp = st + span, y = get<float>(p);
+			}
+			//first region ending past st (regions don't overlap, so stops are sorted)
+			int lo = 0, hi = regions.size();
+			while (lo < hi) {
+				int mid = (lo + hi) / 2;
+				if (regions[mid][1] <= st) {
+					lo  = mid + 1;
+				} else {
+					hi  = mid;
+				}
+			}
+			bool hit  = lo < regions.size() and regions[lo][0] < sp;
+			if (hit) {
+				out.push_back(coverage_run(st, sp, y));
+			}
+		}
+	}
+	return true;
+}
+
+bool bigwig_file::read(string chrom, vector<coverage_run> & out) {
+	//find(), not [], so calls for chromosomes missing from this file stay read-only
+	map<string, int>::const_iterator size  = chrom_size.find(chrom);
+	if (size == chrom_size.end()) {
+		return true;
+	}
+	vector<vector<int> > all  = {{0, size->second + 1}};
+	return read(chrom, all, out);
+}
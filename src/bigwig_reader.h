@@ -0,0 +1,27 @@
+#ifndef bigwig_reader_H
+#define bigwig_reader_H
+#include <string>
+#include <vector>
+#include <map>
+#include "load.h"
+#include "mmap_reader.h"
+using namespace std;
+
+//reads coverage out of a (little endian) bigWig file; the chromosome B+ tree is
+//read on open and the R-tree index is walked per query so only the data blocks
+//overlapping the requested regions are inflated
+class bigwig_file{
+public:
+	mapped_file MF;
+	map<string, int> chrom_ID;
+	map<string, int> chrom_size;
+	long index_offset;
+	unsigned int uncompress_buf;
+	bool open(string);
+	bool read(string, vector<vector<int> >, vector<coverage_run> &);
+	bool read(string, vector<coverage_run> &);
+};
+
+bool is_bigwig(string);
+
+#endif
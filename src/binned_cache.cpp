@@ -0,0 +1,272 @@
+#include "binned_cache.h"
+#include "mmap_reader.h"
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+using namespace std;
+
+static const char BINNED_CACHE_MAGIC[8] = {'T', 'F', 'I', 'T', 'B', 'I', 'N', '\n'};
+static const int BINNED_CACHE_VERSION   = 3;
+
+static long align_64(long x) {
+	return ((x + 63) / 64) * 64;
+}
+
+bool is_binned_cache(string FILE) {
+	char magic[8];
+	ifstream FH(FILE, ios::binary);
+	if (not FH or not FH.read(magic, 8)) {
+		return false;
+	}
+	return memcmp(magic, BINNED_CACHE_MAGIC, 8) == 0;
+}
+
+int write_binned_cache(string FILE, vector<segment *> segments, int br, double ns) {
+	binned_cache_header H;
+	memcpy(H.magic, BINNED_CACHE_MAGIC, 8);
+	H.version   = BINNED_CACHE_VERSION;
+	H.br        = br;
+	H.ns        = ns;
+	H.n_chrom   = segments.size();
+
+	vector<binned_cache_entry> T(segments.size());
+	string names;
+	long table  = sizeof(H) + segments.size() * sizeof(binned_cache_entry);
+	for (int i = 0; i < segments.size(); i++) {
+		names   += segments[i]->chrom;
+	}
+	long offset = align_64(table + names.size());
+	long name   = table;
+	for (int i = 0; i < segments.size(); i++) {
+		segment * S = segments[i];
+		memset(&T[i], 0, sizeof(binned_cache_entry));
+		T[i].name_offset  = name, T[i].name_length = S->chrom.size();
+		name        += S->chrom.size();
+		T[i].start  = S->start, T[i].stop = S->stop;
+		T[i].minX   = S->minX, T[i].maxX = S->maxX, T[i].SCALE = S->SCALE;
+		T[i].N      = S->N, T[i].fN = S->fN, T[i].rN = S->rN;
+		T[i].XN     = S->XN;
+		T[i].pos_bytes    = align_64(T[i].XN * sizeof(double));
+		T[i].count_bytes  = align_64(T[i].XN * sizeof(float));
+		T[i].offset       = offset;
+		offset            += T[i].pos_bytes + 2 * T[i].count_bytes;
+	}
+	ofstream FHW(FILE, ios::binary);
+	if (not FHW) {
+		printf("couldn't open %s for writing\n", FILE.c_str() );
+		return 0;
+	}
+	FHW.write((char *)&H, sizeof(H));
+	FHW.write((char *)T.data(), T.size() * sizeof(binned_cache_entry));
+	FHW.write(names.data(), names.size());
+	vector<char> pad(64, 0);
+	long at     = table + names.size();
+	for (int i = 0; i < segments.size(); i++) {
+		//the file always holds positions, an implicit grid is written out
+		coverage_view V   = segments[i]->view();
+		vector<double> grid;
+		if (V.pos == NULL) {
+			grid.resize(T[i].XN);
+			for (int j = 0; j < T[i].XN; j++) {
+				grid[j]   = V.x(j);
+			}
+		}
+		const char * A[3] = {V.pos == NULL ? (char *)grid.data() : (char *)V.pos, (char *)V.fwd, (char *)V.rev};
+		long at_A[3]      = {T[i].offset, T[i].offset + T[i].pos_bytes, T[i].offset + T[i].pos_bytes + T[i].count_bytes};
+		long n_A[3]       = {long(T[i].XN * sizeof(double)), long(T[i].XN * sizeof(float)), long(T[i].XN * sizeof(float))};
+		for (int j = 0; j < 3; j++) {
+			FHW.write(pad.data(), at_A[j] - at);
+			FHW.write(A[j], n_A[j]);
+			at  = at_A[j] + n_A[j];
+		}
+	}
+	FHW.write(pad.data(), offset - at);
+	FHW.close();
+	if (not FHW) {
+		printf("failed writing %s\n", FILE.c_str() );
+		return 0;
+	}
+	return 1;
+}
+
+//checks the header against the -br/-ns of this run, and that every name and
+//array of the chromosome table lies inside the file
+bool check_binned_cache(string FILE, const char * data, size_t size, int br, double ns) {
+	if (size < sizeof(binned_cache_header)) {
+		printf("%s is not a binned coverage file\n", FILE.c_str() );
+		return false;
+	}
+	const binned_cache_header * H = (const binned_cache_header *)data;
+	if (memcmp(H->magic, BINNED_CACHE_MAGIC, 8) != 0 or H->version != BINNED_CACHE_VERSION
+	        or H->n_chrom < 0 or H->n_chrom > (size - sizeof(binned_cache_header)) / sizeof(binned_cache_entry)) {
+		printf("%s is not a binned coverage file\n", FILE.c_str() );
+		return false;
+	}
+	if (H->br != br or H->ns != ns) {
+		printf("%s was converted with -br %d -ns %g, but this run uses -br %d -ns %g\n",
+		       FILE.c_str(), H->br, H->ns, br, ns );
+		return false;
+	}
+	const binned_cache_entry * T    = (const binned_cache_entry *)(data + sizeof(binned_cache_header));
+	long n    = size;
+	for (int i = 0; i < H->n_chrom; i++) {
+		bool names  = T[i].name_offset >= 0 and T[i].name_length >= 0 and T[i].name_offset <= n
+		              and T[i].name_length <= n - T[i].name_offset;
+		bool arrays = T[i].XN >= 0 and T[i].offset >= 0 and T[i].offset % 64 == 0
+		              and T[i].pos_bytes >= T[i].XN * long(sizeof(double)) and T[i].count_bytes >= T[i].XN * long(sizeof(float))
+		              and T[i].pos_bytes % 64 == 0 and T[i].count_bytes % 64 == 0
+		              and T[i].offset <= n and T[i].pos_bytes <= n and T[i].count_bytes <= n
+		              and T[i].pos_bytes + 2 * T[i].count_bytes <= n - T[i].offset;
+		if (not names or not arrays) {
+			printf("%s has a corrupt chromosome table (entry %d)\n", FILE.c_str(), i );
+			return false;
+		}
+	}
+	return true;
+}
+
+string binned_cache_chrom(const char * data, const binned_cache_entry & E) {
+	return string(data + E.name_offset, E.name_length);
+}
+
+//segments point straight into the (copy on write) mapping, it stays mapped for the
+//life of the process
+vector<segment *> load_binned_cache(string FILE, int br, double ns, string spec_chrom,
+                                    map<string, int>& chromosomes, map<int, string>& ID_to_chrom) {
+	vector<segment *> segments;
+	int fd  = open(FILE.c_str(), O_RDONLY);
+	struct stat st;
+	if (fd < 0 or fstat(fd, &st) != 0) {
+		printf("couln't open FILE %s\n", FILE.c_str());
+		return segments;
+	}
+	void * m  = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (m == MAP_FAILED) {
+		printf("couldn't map %s\n", FILE.c_str());
+		return segments;
+	}
+	char * data = (char *)m;
+	if (not check_binned_cache(FILE, data, st.st_size, br, ns)) {
+		munmap(m, st.st_size);
+		return segments;
+	}
+	const binned_cache_header * H   = (const binned_cache_header *)data;
+	const binned_cache_entry * T    = (const binned_cache_entry *)(data + sizeof(binned_cache_header));
+	for (int i = 0; i < H->n_chrom; i++) {
+		string chrom  = binned_cache_chrom(data, T[i]);
+		if (spec_chrom != "all" and chrom != spec_chrom) {
+			continue;
+		}
+		segment * S = new segment(chrom, T[i].start, T[i].stop);
+		S->minX     = T[i].minX, S->maxX = T[i].maxX, S->SCALE = T[i].SCALE;
+		S->N        = T[i].N, S->fN = T[i].fN, S->rN = T[i].rN;
+		S->XN       = T[i].XN;
+		char * B    = data + T[i].offset;
+		S->X.borrow((double *)B, (float *)(B + T[i].pos_bytes),
+		            (float *)(B + T[i].pos_bytes + T[i].count_bytes), T[i].XN);
+		S->X.to_grid(br, ns);
+		S->chrom_ID = CONTIGS.intern(chrom);
+		chromosomes[chrom]  = S->chrom_ID;
+		ID_to_chrom[S->chrom_ID]  = chrom;
+		segments.push_back(S);
+	}
+	if (segments.empty()) {
+		printf("couldn't find chromosome %s in bedgraph files\n", spec_chrom.c_str());
+	}
+	return segments;
+}
+
+//model module: the bins go in through interval_sweep::add_bins
+int insert_binned_cache(string FILE, map<string, interval_sweep>& NT, int br, double ns) {
+	mapped_file MF;
+	if (not MF.open(FILE)) {
+		cout << "could not open binned coverage file: " << FILE << endl;
+		return 0;
+	}
+	if (not check_binned_cache(FILE, MF.data, MF.size, br, ns)) {
+		return 0;
+	}
+	const binned_cache_header * H   = (const binned_cache_header *)MF.data;
+	const binned_cache_entry * T    = (const binned_cache_entry *)(MF.data + sizeof(binned_cache_header));
+	for (int i = 0; i < H->n_chrom; i++) {
+		string chrom  = binned_cache_chrom(MF.data, T[i]);
+		if (NT.find(chrom) == NT.end()) {
+			continue;
+		}
+		const char * B      = MF.data + T[i].offset;
+		const float * F     = (const float *)(B + T[i].pos_bytes);
+		const float * R     = (const float *)(B + T[i].pos_bytes + T[i].count_bytes);
+		NT[chrom].add_bins(T[i].start, T[i].XN, br, F, R);
+	}
+	return 1;
+}
+
+coverage_spill::coverage_spill() {
+	budget    = 0, resident = 0, spilled = 0;
+	fd        = -1, at = 0;
+}
+
+bool coverage_spill::open(string FILE, double bytes) {
+	budget  = bytes;
+	fd      = ::open(FILE.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0) {
+		printf("couldn't open scratch file %s\n", FILE.c_str() );
+		return false;
+	}
+	unlink(FILE.c_str());
+	return true;
+}
+
+//called from the loading threads; segments that still fit stay as they are,
+//positions of an implicit grid aren't written
+void coverage_spill::add(segment * seg) {
+	long P  = (seg->X.pos == NULL ? 0 : seg->XN * sizeof(double)), C = seg->XN * sizeof(float);
+	lock_guard<mutex> lock(m);
+	if (fd < 0 or resident + P + 2 * C <= budget) {
+		resident  += P + 2 * C;
+		return;
+	}
+	long at_A[3]        = {at, at + align_64(P), at + align_64(P) + align_64(C)};
+	const char * A[3]   = {(char *)seg->X.pos, (char *)seg->X.fwd, (char *)seg->X.rev};
+	long n_A[3]         = {P, C, C};
+	for (int j = 0; j < 3; j++) {
+		if (pwrite(fd, A[j], n_A[j], at_A[j]) != n_A[j]) {
+			printf("failed writing %s:%d-%d to the scratch file, kept in memory\n",
+			       seg->chrom.c_str(), seg->start, seg->stop);
+			resident  += P + 2 * C;
+			return;
+		}
+	}
+	S.push_back(seg);
+	offsets.push_back(at);
+	pos_bytes.push_back(align_64(P));
+	at        = align_64(at_A[2] + C);
+	spilled   += P + 2 * C;
+	seg->X.release();
+}
+
+//the mapping stays for the life of the process, like load_binned_cache
+bool coverage_spill::map() {
+	if (S.empty()) {
+		return true;
+	}
+	void * M  = mmap(NULL, at, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	fd  = -1;
+	if (M == MAP_FAILED) {
+		printf("couldn't map the scratch file\n");
+		return false;
+	}
+	for (int i = 0; i < S.size(); i++) {
+		char * B  = (char *)M + offsets[i];
+		long P    = pos_bytes[i], C = align_64(S[i]->XN * sizeof(float));
+		S[i]->X.borrow(P == 0 ? NULL : (double *)B, (float *)(B + P), (float *)(B + P + C), S[i]->XN);
+	}
+	return true;
+}
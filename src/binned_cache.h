@@ -0,0 +1,62 @@
+#ifndef binned_cache_H
+#define binned_cache_H
+#include <string>
+#include <vector>
+#include <map>
+#include "load.h"
+using namespace std;
+
+//binary container of binned coverage written by the convert module
+//
+//header | chromosome table | chromosome names | per chromosome pos (double), fwd,
+//rev (float), each 64 byte aligned
+//
+//the arrays hold exactly what load_bedgraphs_total leaves in segment::X for the
+//-br and -ns recorded in the header, so they are used in place from the mmap
+
+class binned_cache_header{
+public:
+	char magic[8];
+	int version;
+	int br;
+	double ns;
+	long n_chrom;
+};
+
+class binned_cache_entry{
+public:
+	long name_offset; //the name is name_length bytes at name_offset, not terminated
+	int name_length;
+	int start, stop; //start is the genome position of the left edge of the first bin
+	double minX, maxX, SCALE;
+	double N, fN, rN;
+	long XN;
+	long offset;  //byte offset of pos, fwd follows at offset + pos_bytes, rev after that
+	long pos_bytes, count_bytes;
+};
+
+//-mem_budget: binned coverage past the budget is written to an (already
+//unlinked) scratch file as it is loaded and mapped back read only once loading
+//is done; the kernel then pages it in for the scan or the model and can drop
+//those pages again under memory pressure
+class coverage_spill{
+public:
+	double budget, resident, spilled; //bytes
+	coverage_spill();
+	bool open(string, double);
+	void add(segment *);
+	bool map();
+private:
+	int fd;
+	long at;
+	vector<segment *> S;
+	vector<long> offsets, pos_bytes;
+	mutex m;
+};
+
+bool is_binned_cache(string);
+int write_binned_cache(string, vector<segment *>, int, double);
+vector<segment *> load_binned_cache(string, int, double, string, map<string, int>&, map<int, string>&);
+int insert_binned_cache(string, map<string, interval_sweep>&, int, double);
+
+#endif
@@ -36,8 +36,10 @@ int sample(double ** CDF, int XN, double sum_N, segment * NS, double pi , segmen
 		while (j+1 < XN and CDF[s][j] < U){
 			j++;
 		}
-		if (S->X[s][j] > 0){
-			NS->X[s][j]+=1.;
+		const float * Y 	= (s == 1) ? S->X.fwd : S->X.rev;
+		float * NY 			= (s == 1) ? NS->X.fwd : NS->X.rev;
+		if (Y[j] > 0){
+			NY[j]+=1.;
 			ct++;	
 		}
 
@@ -50,24 +52,25 @@ int sample(double ** CDF, int XN, double sum_N, segment * NS, double pi , segmen
 
 void subsample(segment * S, segment * NS ){
 	double ** CDF 	= new double*[3];
-	NS->X 			= new double*[3];
 	NS->minX = S->minX, NS->maxX = S->maxX;
 	NS->XN 			= S->XN;
 	NS->N 			= S->N;
 	NS->SCALE 		= S->SCALE;
 	int BINS 		= int(S->XN);
+	NS->X.allocate(BINS);
 	for (int j = 0; j < 3; j++){
-		CDF[j]=new double[BINS], NS->X[j]=new double[BINS];
+		CDF[j]=new double[BINS];
 	}
+	coverage_view X = S->view();
 	for (int i = 0 ; i< S->XN; i++){
-		CDF[0][i] 	= S->X[0][i], NS->X[0][i] = S->X[0][i];
+		CDF[0][i] 	= X.x(i), NS->X.pos[i] = X.x(i);
 		CDF[1][i] 	= 0,CDF[2][i] 	= 0;
-		NS->X[1][i] = 0,NS->X[2][i] = 0;		
+		NS->X.fwd[i] = 0,NS->X.rev[i] = 0;		
 	}
 	double forward_sum =0, reverse_sum = 0, sum_N = 0, pi = 0;
 	for (int i = 0; i < S->XN; i++){
-		forward_sum+=S->X[1][i];
-		reverse_sum+=S->X[2][i];
+		forward_sum+=S->X.fwd[i];
+		reverse_sum+=S->X.rev[i];
 	}
 	sum_N 	= forward_sum+reverse_sum;
 	double forward_N = forward_sum;
@@ -75,8 +78,8 @@ void subsample(segment * S, segment * NS ){
 	pi 		= forward_sum / sum_N;
 	forward_sum = 0, reverse_sum = 0;
 	for (int i = 0; i < S->XN; i++){
-		forward_sum+=S->X[1][i];
-		reverse_sum+=S->X[2][i];
+		forward_sum+=S->X.fwd[i];
+		reverse_sum+=S->X.rev[i];
 		CDF[1][i ] 	= forward_sum / forward_N;
 		CDF[2][i ] 	= reverse_sum / reverse_N;
 	}
@@ -0,0 +1,34 @@
+#include "convert_main.h"
+#include "load.h"
+#include "binned_cache.h"
+#include "MPI_comm.h"
+using namespace std;
+int convert_run(params * P, int rank, int nprocs, int job_ID, Log_File * LG){
+	int verbose 	= stoi(P->p["-v"]);
+	LG->write("\ninitializing convert module.............................done\n\n",verbose);
+	//===========================================================================
+	//bin the bedgraph files exactly as the bidir module does and write the bins
+	//out, -ij {-o}{-N}.tfb can then be given to bidir and model (same -br/-ns)
+	if (rank == 0){
+		map<string, int> chrom_to_ID;
+		map<int, string> ID_to_chrom;
+		LG->write("loading bedgraph files..................................", verbose);
+		vector<segment *> segments 	= load::load_bedgraphs_total(P->p["-i"], P->p["-j"], P->p["-ij"],
+			stoi(P->p["-br"]), stof(P->p["-ns"]), P->p["-chr"], chrom_to_ID, ID_to_chrom );
+		if (segments.empty()){
+			printf("exiting...\n");
+		}else{
+			LG->write("done\n", verbose);
+			string OUT 	= P->p["-o"] + P->p["-N"] + ".tfb";
+			LG->write("writing binned coverage.................................", verbose);
+			if (write_binned_cache(OUT, segments, stoi(P->p["-br"]), stof(P->p["-ns"]))){
+				LG->write("done\n", verbose);
+				LG->write("wrote " + OUT + "\n", verbose);
+			}
+			load::clear_segments(segments);
+		}
+	}
+	LG->write("\nexiting convert module..................................done\n\n",verbose);
+	MPI_comm::wait_on_root(rank, nprocs);
+	return 1;
+}
@@ -0,0 +1,8 @@
+#ifndef convert_main_H
+#define convert_main_H
+#include "read_in_parameters.h"
+#include "error_stdo_logging.h"
+
+int convert_run(params *, int, int, int, Log_File *);
+
+#endif
@@ -1,6 +1,7 @@
 #include "density_profiler.h"
 #include <iostream>
 #include "split.h"
+#include "mmap_reader.h"
 #include <fstream>
 #ifdef USING_ICC
 #include <mathimf.h>
@@ -23,35 +24,42 @@ double get_table_mean_var(string GAP_FILE, string bed_file, double res, double b
 
 	map<int, vector<double> > A;
 	map<string, vector<gap_interval>> G;
-	ifstream FH(GAP_FILE);
-	if (FH){
-		string line, chrom, start, stop;
-		vector<string> lineArray;
+	mapped_file FH;
+	text_field F[4];
+	if (FH.open(GAP_FILE)){
+		text_reader R(&FH);
+		line_scanner L(&R);
+		double start, stop;
 
-		while (getline(FH, line)){
-			lineArray 	= splitter(line, "\t");
-			chrom=lineArray[0], start=lineArray[1], stop=lineArray[2];
-			gap_interval I(stof(start), stof(stop));
-			G[chrom].push_back(I);
+		while (L.next()){
+			if (L.split('\t', F, 3) < 3 or not parse_double(F[1], start) or not parse_double(F[2], stop)){
+				continue;
+			}
+			gap_interval I((float)start, (float)stop);
+			G[F[0].str()].push_back(I);
 		
 		
 		}
 	}else{
 		cout<<"Coudn't open: "<<GAP_FILE<<endl;
 	}
-	ifstream BED(bed_file);
-	if (BED){
-		string line, chrom;
+	mapped_file BED;
+	if (BED.open(bed_file)){
+		text_reader R(&BED);
+		line_scanner L(&R);
+		string chrom;
 		int start, stop;
 		double cov;
-		vector<string> lineArray;
 		string prevchrom="";
 		int j,N;
 		int t = 0;
-		while (getline(BED, line)){
-			lineArray 	= splitter(line, "\t");
-			chrom=lineArray[0], start=stoi(lineArray[1]), stop=stoi(lineArray[2]), cov=abs(stof(lineArray[3]));
-			if (chrom!=prevchrom){
+		while (L.next()){
+			if (not parse_bedgraph(L, F, start, stop, cov)){
+				continue;
+			}
+			cov 	= abs(float(cov));
+			if (not F[0].equals(prevchrom)){
+				chrom=F[0].str();
 				if (G.find(chrom)!=G.end()){
 					j= 0,N=G[chrom].size();
 					if (t > 5){
@@ -0,0 +1,43 @@
+#include "fft.h"
+#include <cmath>
+using namespace std;
+
+int fft_size(int n) {
+	int m = 1;
+	while (m < n) {
+		m *= 2;
+	}
+	return m;
+}
+
+fft_plan::fft_plan(int N) {
+	n = N;
+	roots.resize(n / 2);
+	for (int k = 0; k < n / 2; k++) {
+		roots[k]  = polar(1.0, -2 * M_PI * k / n);
+	}
+}
+
+void fft_plan::run(complex<double> * a, bool inverse) const {
+	for (int i = 1, j = 0; i < n; i++) {
+		int bit = n >> 1;
+		for (; j & bit; bit >>= 1) {
+			j ^= bit;
+		}
+		j ^= bit;
+		if (i < j) {
+			swap(a[i], a[j]);
+		}
+	}
+	for (int len = 2; len <= n; len *= 2) {
+		int stride  = n / len;
+		for (int i = 0; i < n; i += len) {
+			for (int k = 0; k < len / 2; k++) {
+				complex<double> w = inverse ? conj(roots[k * stride]) : roots[k * stride];
+				complex<double> u = a[i + k], v = a[i + k + len / 2] * w;
+				a[i + k]            = u + v;
+				a[i + k + len / 2]  = u - v;
+			}
+		}
+	}
+}
@@ -0,0 +1,20 @@
+#ifndef fft_H
+#define fft_H
+#include <vector>
+#include <complex>
+using namespace std;
+
+//radix 2 complex FFT of a fixed power of two length; the roots of unity are
+//computed once, run() transforms in place and doesn't scale the inverse by 1/n
+class fft_plan{
+public:
+	int n;
+	vector<complex<double>> roots;
+	fft_plan(int);
+	void run(complex<double> *, bool) const;
+};
+
+//smallest power of two >= n
+int fft_size(int);
+
+#endif
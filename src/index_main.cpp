@@ -0,0 +1,50 @@
+#include "index_main.h"
+#include "bedgraph_index.h"
+#include "mmap_reader.h"
+#include "binned_cache.h"
+#include "bigwig_reader.h"
+#include "MPI_comm.h"
+using namespace std;
+int index_run(params * P, int rank, int nprocs, int job_ID, Log_File * LG){
+	int verbose 	= stoi(P->p["-v"]);
+	LG->write("\ninitializing index module...............................done\n\n",verbose);
+	//===========================================================================
+	//writes FILE.tfi next to each bedgraph file, -chr runs then read only the
+	//bytes of their chromosome
+	if (rank == 0){
+		vector<string> FILES;
+		if (not P->p["-ij"].empty()){
+			FILES 	= {P->p["-ij"]};
+		}else{
+			FILES 	= {P->p["-i"], P->p["-j"]};
+		}
+		for (int u = 0; u < FILES.size(); u++){
+			if (is_binned_cache(FILES[u]) or is_bigwig(FILES[u])){
+				LG->write(FILES[u] + " is already indexed, skipping\n", verbose);
+				continue;
+			}
+			bedgraph_index I;
+			mapped_file MF;
+			if (not stat_bedgraph(FILES[u], I.size, I.mtime, I.mtime_ns) or not MF.open(FILES[u])){
+				printf("couln't open FILE %s\n", FILES[u].c_str());
+				continue;
+			}
+			if (MF.format == GZIP_FILE){
+				LG->write(FILES[u] + " is plain gzip and is read through every run, bgzip it to index it\n", verbose);
+				continue;
+			}
+			LG->write("indexing " + FILES[u] + "...", verbose);
+			if (not I.build(&MF)){
+				printf("corrupt compressed data in %s\n", FILES[u].c_str());
+			}else if (I.write(FILES[u])){
+				LG->write("done\n", verbose);
+				LG->write("wrote " + bedgraph_index_path(FILES[u]) + "\n", verbose);
+			}else{
+				printf("couldn't write %s\n", bedgraph_index_path(FILES[u]).c_str());
+			}
+		}
+	}
+	LG->write("\nexiting index module....................................done\n\n",verbose);
+	MPI_comm::wait_on_root(rank, nprocs);
+	return 1;
+}
@@ -0,0 +1,8 @@
+#ifndef index_main_H
+#define index_main_H
+#include "read_in_parameters.h"
+#include "error_stdo_logging.h"
+
+int index_run(params *, int, int, int, Log_File *);
+
+#endif
@@ -11,6 +11,12 @@
 #include "read_in_parameters.h"
 #include "across_segments.h"
 #include "model_selection.h"
+#include "mmap_reader.h"
+#include "binned_cache.h"
+#include "bigwig_reader.h"
+#include "bedgraph_index.h"
+#include "thread_placement.h"
+#include <omp.h>
 #include <cmath>
 #include <math.h>
 #include <limits>
@@ -19,6 +25,7 @@
 #include <unistd.h>
 #include <random>
 #include <exception>
+#include <cstring>
 
 #include <stdio.h>
 #include <time.h>
@@ -41,7 +48,7 @@ segment::segment(string chr, int st, int sp) {
    ID    = 0;
    strand  = ".";
    chrom_ID = 0;
-
+   streaming = 0;
 }
 segment::segment(string chr, int st, int sp, int i) {
    chrom = chr;
@@ -56,7 +63,7 @@ segment::segment(string chr, int st, int sp, int i) {
    ID    = i;
    strand  = ".";
    chrom_ID = 0;
-
+   streaming = 0;
 }
 
 segment::segment(string chr, int st, int sp, int i, string STR) {
@@ -72,7 +79,7 @@ segment::segment(string chr, int st, int sp, int i, string STR) {
    ID    = i;
    strand  = STR;
    chrom_ID = 0;
-
+   streaming = 0;
 }
 
 segment::segment() {
@@ -84,6 +91,7 @@ segment::segment() {
    ID    = 0;
    strand  = ".";
    chrom_ID = 0;
+   streaming = 0;
 }
 
 string segment::write_out() {
@@ -116,6 +124,301 @@ void segment::add2(int strand, double x, double y) {
       reverse.push_back(v2);
    }
 }
+void segment::add_run(int strand, int st, int sp, double y) {
+   if (sp <= st) {
+      return;
+   }
+   if (forward.empty() && reverse.empty() && forward_runs.empty() && reverse_runs.empty()) {
+      minX = st;
+      maxX = sp - 1;
+   } else {
+      if (st < minX) {
+         minX = st;
+         start = st;
+      }
+      if (sp - 1 > maxX) {
+         maxX = sp - 1;
+         stop = sp - 1;
+      }
+   }
+   if (strand == 1) {
+      forward_runs.push_back(coverage_run(st, sp, y));
+   } else if (strand == -1) {
+      reverse_runs.push_back(coverage_run(st, sp, y));
+   }
+}
+
+coverage_run::coverage_run() {
+   start = 0, stop = 0, coverage = 0;
+}
+coverage_run::coverage_run(int st, int sp, double y) {
+   start = st, stop = sp, coverage = y;
+}
+
+//========================================================================
+//binned coverage storage
+
+size_t align_64(size_t x) {
+   return ((x + 63) / 64) * 64;
+}
+
+coverage_block::coverage_block() {
+   pos = NULL, fwd = NULL, rev = NULL;
+   n     = 0;
+   delta = 0, scale = 0;
+   owned = NULL;
+}
+coverage_block::~coverage_block() {
+   release();
+}
+void coverage_block::allocate(int N) {
+   release();
+   size_t P  = align_64(max(N, 1) * sizeof(double)), C = align_64(max(N, 1) * sizeof(float));
+   if (posix_memalign(&owned, 64, P + 2 * C) != 0) {
+      throw bad_alloc();
+   }
+   pos   = (double *)owned;
+   fwd   = (float *)((char *)owned + P);
+   rev   = (float *)((char *)owned + P + C);
+   n     = N;
+}
+//fwd | rev only, positions come from the grid
+void coverage_block::allocate_grid(int N, double d, double sc) {
+   release();
+   size_t C  = align_64(max(N, 1) * sizeof(float));
+   if (posix_memalign(&owned, 64, 2 * C) != 0) {
+      throw bad_alloc();
+   }
+   fwd   = (float *)owned;
+   rev   = (float *)((char *)owned + C);
+   n     = N;
+   delta = d, scale = sc;
+}
+
+//drops pos if every position is exactly what the grid gives (bin() and
+//stream_bin() step by whole bases from the first bin); borrowed coverage only
+//stops pointing at its positions
+bool coverage_block::to_grid(double d, double sc) {
+   if (pos == NULL or sc == 0) {
+      return pos == NULL;
+   }
+   for (int i = 0; i < n; i++) {
+      if (pos[i] != (i * d) / sc) {
+         return false;
+      }
+   }
+   if (owned == NULL) {
+      pos   = NULL;
+      delta = d, scale = sc;
+      return true;
+   }
+   coverage_block B;
+   B.allocate_grid(n, d, sc);
+   copy(fwd, fwd + n, B.fwd);
+   copy(rev, rev + n, B.rev);
+   swap(B);
+   return true;
+}
+
+void coverage_block::borrow(double * P, float * F, float * R, int N) {
+   release();
+   pos = P, fwd = F, rev = R;
+   n   = N;
+}
+void coverage_block::release() {
+   free(owned);
+   owned = NULL;
+   pos = NULL, fwd = NULL, rev = NULL;
+   n     = 0;
+}
+void coverage_block::swap(coverage_block & other) {
+   std::swap(pos, other.pos), std::swap(fwd, other.fwd), std::swap(rev, other.rev);
+   std::swap(n, other.n), std::swap(owned, other.owned);
+   std::swap(delta, other.delta), std::swap(scale, other.scale);
+}
+//-pin: moves owned coverage into a fresh block that every OpenMP thread first
+//touches over the chunk it scans (scan_chunk), so the pages end up on the NUMA
+//node of the thread that reads them; borrowed (mapped) coverage stays put
+void coverage_block::place() {
+   if (owned == NULL or n == 0) {
+      return;
+   }
+   coverage_block B;
+   if (pos == NULL) {
+      B.allocate_grid(n, delta, scale);
+   } else {
+      B.allocate(n);
+   }
+   int threads   = omp_get_max_threads();
+   #pragma omp parallel num_threads(threads)
+   {
+      int start, stop;
+      scan_chunk(n, threads, omp_get_thread_num(), start, stop);
+      if (pos != NULL) {
+         copy(pos + start, pos + stop, B.pos + start);
+      }
+      copy(fwd + start, fwd + stop, B.fwd + start);
+      copy(rev + start, rev + stop, B.rev + start);
+   }
+   swap(B);
+}
+coverage_view coverage_block::view() const {
+   coverage_view V;
+   V.pos = pos, V.fwd = fwd, V.rev = rev;
+   V.n   = n;
+   V.delta = delta, V.scale = scale;
+   return V;
+}
+coverage_view segment::view() const {
+   return X.view();
+}
+
+contig_dictionary CONTIGS;
+
+int contig_dictionary::intern(string chrom) {
+   map<string, int>::iterator it  = IDS.find(chrom);
+   if (it != IDS.end()) {
+      return it->second;
+   }
+   names.push_back(chrom);
+   IDS[chrom]  = names.size();
+   return names.size();
+}
+
+int contig_dictionary::find(string chrom) const {
+   map<string, int>::const_iterator it  = IDS.find(chrom);
+   return it == IDS.end() ? 0 : it->second;
+}
+
+string contig_dictionary::name(int ID) const {
+   return (ID > 0 and ID <= names.size()) ? names[ID - 1] : "";
+}
+
+//widths go from coarse to fine; the finest level is summed from the bins and
+//every level whose width is a multiple of the next one from that level, so the
+//bins are read once
+coverage_pyramid::coverage_pyramid(coverage_view V, vector<int> widths) {
+   width   = widths;
+   fwd.resize(width.size()), rev.resize(width.size());
+   for (int l = width.size() - 1; l >= 0; l--) {
+      int blocks  = (V.n + width[l] - 1) / width[l];
+      fwd[l].assign(blocks, 0.0), rev[l].assign(blocks, 0.0);
+      if (l + 1 < width.size() and width[l] % width[l + 1] == 0) {
+         int r   = width[l] / width[l + 1];
+         for (int i = 0; i < fwd[l + 1].size(); i++) {
+            fwd[l][i / r]  += fwd[l + 1][i];
+            rev[l][i / r]  += rev[l + 1][i];
+         }
+         continue;
+      }
+      for (int i = 0; i < V.n; i++) {
+         fwd[l][i / width[l]]  += V.fwd[i];
+         rev[l][i / width[l]]  += V.rev[i];
+      }
+   }
+}
+
+//coverage of strand (0 forward, 1 reverse) over every block of level l that
+//overlaps bins [a, b), so never less than the coverage of the bins themselves
+double coverage_pyramid::sum(int l, int strand, int a, int b) const {
+   const vector<double> & B   = (strand == 0 ? fwd[l] : rev[l]);
+   double S  = 0;
+   for (int i = a / width[l]; i <= (b - 1) / width[l] and i < B.size(); i++) {
+      S   += B[i];
+   }
+   return S;
+}
+
+//bin-on-parse: adds a run straight into bins of width delta anchored at the first
+//base ever added, returns false if the run starts left of that anchor off the grid
+//(the caller then has to fall back to add_run and bin)
+bool segment::stream_add(int strand, int st, int sp, double y, int delta) {
+   if (sp <= st) {
+      return true;
+   }
+   if (not streaming) {
+      streaming = 1;
+      minX  = st, maxX = sp - 1;
+      start = st, stop = sp - 1;
+   }
+   if (st < minX) {
+      if ((int(minX) - st) % delta) {
+         return false;
+      }
+      int shift = (int(minX) - st) / delta;
+      stream_forward.insert(stream_forward.begin(), shift, 0.0);
+      stream_reverse.insert(stream_reverse.begin(), shift, 0.0);
+      minX  = st, start = st;
+   }
+   if (sp - 1 > maxX) {
+      maxX  = sp - 1, stop = sp - 1;
+   }
+   vector<double> & B  = (strand == 1) ? stream_forward : stream_reverse;
+   int o     = int(minX);
+   int last  = (sp - 1 - o) / delta;
+   if (B.size() <= last) {
+      B.resize(last + 1, 0.0);
+   }
+   for (int b = (st - o) / delta; b <= last; b++) {
+      int lo  = max(st, o + b * delta), hi = min(sp, o + (b + 1) * delta);
+      B[b]  += y * (hi - lo);
+   }
+   return true;
+}
+
+//turns the bins filled by stream_add into X, same layout as bin(delta, scale, erase)
+void segment::stream_bin(double delta, double scale, int erase) {
+   int BINS  = (maxX - minX) / delta;
+   start = minX, stop = maxX;
+   X.allocate(BINS);
+   N         = 0;
+   fN = 0, rN = 0;
+   XN        = BINS;
+   X.pos[0]  = double(minX);
+   for (int i = 1; i < BINS; i++) {
+      X.pos[i]  = X.pos[i - 1] + delta;
+   }
+   //the last bin never receives coverage in bin() either
+   for (int i = 0; i < BINS; i++) {
+      double f  = (i + 1 < BINS and i < stream_forward.size()) ? stream_forward[i] : 0;
+      double r  = (i + 1 < BINS and i < stream_reverse.size()) ? stream_reverse[i] : 0;
+      X.fwd[i]  = f, X.rev[i] = r;
+      fN += f, rN += r;
+   }
+   N         = fN + rN;
+   vector<double>().swap(stream_forward);
+   vector<double>().swap(stream_reverse);
+   streaming = 0;
+   scale_bins(scale, erase);
+   if (not erase) {
+      X.to_grid(delta, scale);
+   }
+}
+
+vector<coverage_run> sort_runs(vector<coverage_run> vec) {
+   sort(vec.begin(), vec.end(),
+        [](const coverage_run & a, const coverage_run & b) {
+      return a.start < b.start;
+   });
+   return vec;
+}
+
+//adds every base of a run to the bin it falls in, same as calling add2 for each
+//base; bases at or past the last bin edge are dropped just like bin() does for points
+int spread_run(const double * pos, float * Y, int BINS, const coverage_run & r, int j, double & S) {
+   while (j < BINS and pos[j] <= r.start) {
+      j++;
+   }
+   double x = r.start, upto;
+   for (int b = j; b < BINS and x < r.stop; b++) {
+      upto        = min(ceil(pos[b]), double(r.stop));
+      Y[b - 1]    += r.coverage * (upto - x);
+      S           += r.coverage * (upto - x);
+      x           = upto;
+   }
+   return j;
+}
+
 vector<vector<double>> bubble_sort_by_1(vector<vector<double>> vec) { //sort vector of vectors by second
     sort(vec.begin(), vec.end(),
              [](const  vector<double>& a, const  vector<double>& b) {
@@ -126,30 +429,29 @@ vector<vector<double>> bubble_sort_by_1(vector<vector<double>> vec) { //sort vec
 
 
 void segment::bin(double delta, double scale, int erase) {
-   X         = new double*[3];
    SCALE       = scale;
    int BINS;
    BINS    = (maxX - minX) / delta;
    start = minX, stop = maxX;
-   for (int j = 0 ; j < 3; j++) {
-      X[j]    = new double[BINS];
-   }
+   X.allocate(BINS);
    N         = 0;
    fN = 0, rN = 0;
    XN        = BINS;
    //===================
    //populate bin ranges
-   X[0][0]     = double(minX);
-   X[1][0] = 0, X[2][0] = 0;
+   X.pos[0]    = double(minX);
+   X.fwd[0] = 0, X.rev[0] = 0;
    forward     = bubble_sort_by_1(forward);
    reverse     = bubble_sort_by_1(reverse);
+   forward_runs  = sort_runs(forward_runs);
+   reverse_runs  = sort_runs(reverse_runs);
 
 
 
    for (int i = 1; i < BINS; i++) {
-      X[0][i]   = X[0][i - 1] + delta;
-      X[1][i]   = 0;
-      X[2][i]   = 0;
+      X.pos[i]  = X.pos[i - 1] + delta;
+      X.fwd[i]  = 0;
+      X.rev[i]  = 0;
    }
 
    // ===================
@@ -157,11 +459,11 @@ void segment::bin(double delta, double scale, int erase) {
    int j   = 0;
    //printf("start: %d , stop: %d , bins: %d ,delta: %f, forward: %d, reverse: %d\n", start, stop, BINS, delta, forward.size(), reverse.size() );
    for (int i = 0 ; i < forward.size(); i++) {
-      while (j < BINS and X[0][j] <= forward[i][0]) {
+      while (j < BINS and X.pos[j] <= forward[i][0]) {
          j++;
       }
-      if (j < BINS and forward[i][0] <= X[0][j]) {
-         X[1][j - 1] += forward[i][1];
+      if (j < BINS and forward[i][0] <= X.pos[j]) {
+         X.fwd[j - 1] += forward[i][1];
          N += forward[i][1];
          fN += forward[i][1];
       }
@@ -170,21 +472,45 @@ void segment::bin(double delta, double scale, int erase) {
    //===================
    //insert reverse strand
    for (int i = 0 ; i < reverse.size(); i++) {
-      while (j < BINS and X[0][j] <= reverse[i][0]) {
+      while (j < BINS and X.pos[j] <= reverse[i][0]) {
          j++;
       }
-      if (j < BINS and reverse[i][0] <= X[0][j]) {
-         X[2][j - 1] += reverse[i][1];
+      if (j < BINS and reverse[i][0] <= X.pos[j]) {
+         X.rev[j - 1] += reverse[i][1];
          N += reverse[i][1];
          rN += reverse[i][1];
       }
    }
    //===================
+   //insert run length coverage (bedgraph lines that were never expanded per base)
+   double S_runs = 0;
+   j   = 0;
+   for (int i = 0 ; i < forward_runs.size(); i++) {
+      j = spread_run(X.pos, X.fwd, BINS, forward_runs[i], j, S_runs);
+   }
+   N += S_runs, fN += S_runs;
+   S_runs  = 0, j = 0;
+   for (int i = 0 ; i < reverse_runs.size(); i++) {
+      j = spread_run(X.pos, X.rev, BINS, reverse_runs[i], j, S_runs);
+   }
+   N += S_runs, rN += S_runs;
+   scale_bins(scale, erase);
+   if (not erase) {
+      X.to_grid(delta, scale);
+   }
+}
+
+//takes freshly filled bins (X, XN) and moves them onto the -ns scale, optionally
+//dropping bins without coverage, then releases the unbinned coverage
+void segment::scale_bins(double scale, int erase) {
+   int BINS  = XN;
+   int j;
+   SCALE     = scale;
    //scale data down for numerical stability
    if (scale) {
       for (int i = 0; i < BINS; i ++ ) {
 
-         X[0][i]   = (X[0][i] - minX) / scale;
+         X.pos[i]  = (X.pos[i] - minX) / scale;
          // X[1][i]/=delta;
          // X[2][i]/=delta;
       }
@@ -195,33 +521,27 @@ void segment::bin(double delta, double scale, int erase) {
 
    int realN     = 0;
    for (int i = 0; i < BINS; i++) {
-      if (X[1][i] > 0 or X[2][i] > 0) {
+      if (X.fwd[i] > 0 or X.rev[i] > 0) {
          realN++;
       }
    }
    if (erase) {
-      double ** newX  = new double*[3];
-      for (int j = 0; j < 3; j++) {
-         newX[j]   = new double[realN];
-      }
+      coverage_block newX;
+      newX.allocate(realN);
       j = 0;
       for (int i = 0; i < BINS; i ++) {
-         if (X[1][i] > 0 or X[2][i] > 0) {
-            newX[0][j]  = X[0][i];
-            newX[1][j]  = X[1][i];
-            newX[2][j]  = X[2][i];
+         if (X.fwd[i] > 0 or X.rev[i] > 0) {
+            newX.pos[j] = X.pos[i];
+            newX.fwd[j] = X.fwd[i];
+            newX.rev[j] = X.rev[i];
             j++;
          }
       }
       if (realN != j) {
          printf("WHAT? %d,%d\n", j, realN);
       }
-      //clear previous memory
-      for (int i = 0; i < 3; i ++) {
-         delete X[i];
-      }
-      delete X;
-      X         = newX;
+      //previous block is freed with newX
+      X.swap(newX);
       XN        = realN;
    }
    if (scale) {
@@ -250,10 +570,12 @@ void segment::bin(double delta, double scale, int erase) {
    }
    double S = 0;
    for (int i = 0; i < XN; i++) {
-      S += X[1][i];
+      S += X.fwd[i];
    }
    forward.clear();
    reverse.clear();
+   vector<coverage_run>().swap(forward_runs);
+   vector<coverage_run>().swap(reverse_runs);
 }
 
 //================================================================================================
@@ -302,6 +624,63 @@ void node::insert_coverage(vector<double> x, int s) {
       left->insert_coverage(x,  s);
    }
 }
+interval_sweep::interval_sweep() {
+   next = 0, last = 0;
+}
+interval_sweep::interval_sweep(vector<segment *> segments) {
+   S     = segments;
+   sort(S.begin(), S.end(), [](const segment * a, const segment * b) {
+      return a->start < b->start;
+   });
+   reach.resize(S.size());
+   for (int i = 0; i < S.size(); i++) {
+      reach[i]  = max(S[i]->stop, i ? reach[i - 1] : S[i]->stop);
+   }
+   next  = 0, last = 0;
+}
+
+void interval_sweep::add(int strand, int st, int sp, double y) {
+   if (st < last) { //intervals before next all stop at or before st
+      next  = upper_bound(reach.begin(), reach.end(), st) - reach.begin();
+      active.clear();
+   }
+   last  = st;
+   while (next < S.size() and S[next]->start + 1 < sp) {
+      active.push_back(S[next++]);
+   }
+   for (int i = 0; i < active.size(); ) {
+      segment * s   = active[i];
+      if (s->stop <= st) { //runs from here on start at st or later
+         active[i]   = active.back();
+         active.pop_back();
+         continue;
+      }
+      int lo  = max(st, s->start + 1), hi = min(sp, s->stop);
+      if (lo < hi) {
+         if (strand == 1) {
+            s->forward_runs.push_back(coverage_run(lo, hi, y));
+         } else {
+            s->reverse_runs.push_back(coverage_run(lo, hi, y));
+         }
+      }
+      i++;
+   }
+}
+
+//binned coverage (n bins of br bases from start): each bin goes in as one base at its
+//center, BIN() re-bins them
+void interval_sweep::add_bins(int start, long n, int br, const float * F, const float * R) {
+   for (long j = 0; j < n; j++) {
+      int x = start + j * br + br / 2;
+      if (F[j] > 0) {
+         add(1, x, x + 1, F[j]);
+      }
+      if (R[j] > 0) {
+         add(-1, x, x + 1, R[j]);
+      }
+   }
+}
+
 void node::searchInterval(int start, int stop, vector<int>& finds ) {
    for (int i = 0 ; i < current.size(); i++) {
       if (stop > current[i]->start and  start < current[i]->stop  ) {
@@ -439,14 +818,300 @@ int check_ID_name(string & INFO) {
 //LOADING from file functions...need to clean this up...
 
 
+bedgraph_block::bedgraph_block(int U, long B, int LINE) {
+   u = U, begin = B, end = B, line = LINE;
+}
+
+//0: parsed, 1: badly formatted line (bad_line is set), 2: couldn't be binned while parsing
+//R[u] reads the text of file u, damaged compressed data ends the block early and
+//leaves MF[u].corrupt set
+int read_bedgraph_block(mapped_file * MF, text_reader * R, const bedgraph_block & B, segment * S,
+                        int BINS, int streaming, int & bad_line) {
+   R[B.u].open(&MF[B.u], B.begin, B.end);
+   line_scanner L(&R[B.u]);
+   text_field F[4];
+   int start, stop;
+   int line  = B.line;
+   double coverage;
+   while (L.next()) {
+      if (not parse_bedgraph(L, F, start, stop, coverage)) {
+         bad_line  = line;
+         return 1;
+      }
+      line++;
+      coverage    = float(coverage);
+      int strand  = (B.u == 0 and coverage > 0) ? 1 : -1;
+      if (streaming) {
+         if (not S->stream_add(strand, start, stop, abs(coverage), BINS)) {
+            return 2;
+         }
+      } else {
+         S->add_run(strand, start, stop, abs(coverage));
+      }
+   }
+   return 0;
+}
+
+//builds and bins the segment of one chromosome from all of its blocks; blocks are
+//binned while parsing unless the chromosome isn't sorted, then they are read as runs
+segment * load_bedgraph_chromosome(mapped_file * MF, string chrom, vector<bedgraph_block> & B,
+                                   int fallback, int BINS, double scale, int & bad_line) {
+   text_reader R[2];
+   R[B[0].u].open(&MF[B[0].u], B[0].begin, B[0].end);
+   line_scanner L(&R[B[0].u]);
+   text_field F[4];
+   int start, stop;
+   double coverage;
+   if (not L.next() or not parse_bedgraph(L, F, start, stop, coverage)) {
+      bad_line  = B[0].line;
+      return NULL;
+   }
+   segment * S   = NULL;
+   int status    = 2;
+   if (not fallback) {
+      S    = new segment(chrom, start, stop);
+      for (int b = 0; b < B.size(); b++) {
+         status  = read_bedgraph_block(MF, R, B[b], S, BINS, 1, bad_line);
+         if (status) {
+            break;
+         }
+      }
+      if (status == 0) {
+         S->stream_bin(BINS, scale, 0);
+         return S;
+      }
+      delete S;
+      S    = NULL;
+   }
+   if (status == 2) {
+      S    = new segment(chrom, start, stop);
+      for (int b = 0; b < B.size(); b++) {
+         if (read_bedgraph_block(MF, R, B[b], S, BINS, 0, bad_line)) {
+            delete S;
+            return NULL;
+         }
+      }
+      S->bin(BINS, scale, 0);
+   }
+   return S;
+}
+
+//bigWig input: the coverage of one chromosome comes straight out of the index,
+//then it is binned like a sorted bedgraph block would be
+segment * load_bigwig_chromosome(bigwig_file * BW, int NF, string chrom, int BINS, double scale,
+                                 int & failed) {
+   vector<coverage_run> R[2];
+   for (int u = 0; u < NF; u++) {
+      if (not BW[u].read(chrom, R[u])) {
+         failed = 1;
+         return NULL;
+      }
+   }
+   coverage_run * first  = NULL;
+   for (int u = NF - 1; u >= 0; u--) {
+      if (not R[u].empty()) {
+         first = &R[u][0];
+      }
+   }
+   if (first == NULL) {
+      return NULL;
+   }
+   segment * S   = new segment(chrom, first->start, first->stop);
+   bool streamed = true;
+   for (int u = 0; u < NF and streamed; u++) {
+      for (int r = 0; r < R[u].size() and streamed; r++) {
+         streamed  = S->stream_add((u == 0 and R[u][r].coverage > 0) ? 1 : -1, R[u][r].start,
+                                   R[u][r].stop, abs(R[u][r].coverage), BINS);
+      }
+   }
+   if (streamed) {
+      S->stream_bin(BINS, scale, 0);
+      return S;
+   }
+   delete S;
+   S   = new segment(chrom, first->start, first->stop);
+   for (int u = 0; u < NF; u++) {
+      for (int r = 0; r < R[u].size(); r++) {
+         S->add_run((u == 0 and R[u][r].coverage > 0) ? 1 : -1, R[u][r].start, R[u][r].stop,
+                    abs(R[u][r].coverage));
+      }
+   }
+   S->bin(BINS, scale, 0);
+   return S;
+}
+
+vector<segment*> load_bigwigs_total(vector<string> FILES, int BINS, double scale, string spec_chrom,
+                                    map<string, int>& chromosomes, map<int, string>& ID_to_chrom,
+                                    coverage_spill * spill) {
+   vector<segment*> segments;
+   bigwig_file * BW  = new bigwig_file[FILES.size()];
+   map<string, int> names;
+   typedef map<string, int>::iterator it_type;
+   for (int u = 0; u < FILES.size(); u++) {
+      if (not BW[u].open(FILES[u])) {
+         delete [] BW;
+         return segments;
+      }
+      for (it_type c = BW[u].chrom_size.begin(); c != BW[u].chrom_size.end(); c++) {
+         if (c->first == spec_chrom or spec_chrom == "all") {
+            names[c->first] = 1;
+         }
+      }
+   }
+   vector<string> chroms;
+   for (it_type c = names.begin(); c != names.end(); c++) {
+      chroms.push_back(c->first);
+   }
+   vector<segment *> G(chroms.size(), (segment *)NULL);
+   int failed  = 0;
+   #pragma omp parallel for schedule(dynamic) reduction(||:failed)
+   for (int i = 0; i < chroms.size(); i++) {
+      G[i]  = load_bigwig_chromosome(BW, FILES.size(), chroms[i], BINS, scale, failed);
+      if (spill != NULL and G[i] != NULL) {
+         spill->add(G[i]);
+      }
+   }
+   delete [] BW;
+   for (int i = 0; i < G.size(); i++) {
+      if (G[i] == NULL) {
+         continue;
+      }
+      if (failed) {
+         delete G[i];
+         continue;
+      }
+      G[i]->chrom_ID  = CONTIGS.intern(G[i]->chrom);
+      chromosomes[G[i]->chrom] = G[i]->chrom_ID;
+      ID_to_chrom[G[i]->chrom_ID]  = G[i]->chrom;
+      segments.push_back(G[i]);
+   }
+   if (failed) {
+      printf("\ncorrupt data block in bigWig file(s)\n");
+   } else if (segments.empty() and spec_chrom != "all") {
+      printf("couldn't find chromosome %s in bedgraph files\n", spec_chrom.c_str());
+   }
+   return segments;
+}
+
+//model module: coverage of the intervals of interest only, fetched through the index
+int insert_bigwigs(vector<string> FILES, map<string, vector<segment *> > & A,
+                   map<string, interval_sweep> & NT) {
+   typedef map<string, vector<segment *> >::iterator it_type;
+   vector<string> chroms;
+   for (it_type c = A.begin(); c != A.end(); c++) {
+      chroms.push_back(c->first);
+   }
+   for (int u = 0; u < FILES.size(); u++) {
+      bigwig_file BW;
+      if (not BW.open(FILES[u])) {
+         return 0;
+      }
+      //the threads below only look up existing keys
+      for (int i = 0; i < chroms.size(); i++) {
+         NT[chroms[i]];
+      }
+      int failed  = 0;
+      #pragma omp parallel for schedule(dynamic) reduction(||:failed)
+      for (int i = 0; i < chroms.size(); i++) {
+         vector<vector<int> > regions;
+         vector<segment *> & intervals = A.find(chroms[i])->second;
+         for (int s = 0; s < intervals.size(); s++) {
+            regions.push_back({intervals[s]->start, intervals[s]->stop});
+         }
+         sort(regions.begin(), regions.end());
+         int k = 0;
+         for (int r = 1; r < regions.size(); r++) {
+            if (regions[r][0] <= regions[k][1]) {
+               regions[k][1] = max(regions[k][1], regions[r][1]);
+            } else {
+               regions[++k]  = regions[r];
+            }
+         }
+         regions.resize(min(int(regions.size()), k + 1));
+         vector<coverage_run> R;
+         if (not BW.read(chroms[i], regions, R)) {
+            failed  = 1;
+            continue;
+         }
+         interval_sweep * T  = &NT.find(chroms[i])->second;
+         for (int r = 0; r < R.size(); r++) {
+            T->add((R[r].coverage < 0 or u == 1) ? -1 : 1, R[r].start, R[r].stop, abs(R[r].coverage));
+         }
+      }
+      if (failed) {
+         printf("\ncorrupt data block in bigWig file %s\n", FILES[u].c_str());
+         return 0;
+      }
+   }
+   return 1;
+}
+
+//(1) of load_bedgraphs_total: where each chromosome starts and stops, from the
+//FILE.tfi index when it is current; -chr runs write it so later runs only touch
+//their chromosome. Plain gzip files are never seeked from FILE.tfi: they are read
+//through once, which leaves the (in memory) points later seeks into them start
+//from; BGZF files are. -1, or the file that couldn't be opened
+int find_bedgraph_blocks(vector<string> & FILES, mapped_file * MF, string spec_chrom,
+                          map<string, vector<bedgraph_block> > & BLOCKS,
+                          map<string, int> & FALLBACK, vector<int> & first_line, int & FOUND) {
+   int line_number = 0;
+   for (int u = 0 ; u < FILES.size(); u++) {
+      bedgraph_index I;
+      long size, mtime;
+      int mtime_ns;
+      bool regular  = stat_bedgraph(FILES[u], size, mtime, mtime_ns);
+      if (not MF[u].open(FILES[u]) ) {
+         return u;
+      }
+      bool indexed  = regular and MF[u].format != GZIP_FILE and I.read(FILES[u]) and I.current(FILES[u]);
+      if (not indexed) {
+         bool built  = I.build(&MF[u]); //damaged data leaves MF[u].corrupt set
+         I.size  = size, I.mtime = mtime, I.mtime_ns = mtime_ns;
+         if (built and regular and MF[u].format != GZIP_FILE and spec_chrom != "all") {
+            I.write(FILES[u]); //no index where it can't be written, this run doesn't need it
+         }
+      }
+      first_line[u]   = line_number;
+      map<string, int> seen;
+      for (int e = 0; e < I.entries.size(); e++) {
+         string chrom   = I.entries[e].chrom;
+         bedgraph_block B(u, I.entries[e].begin, line_number + I.entries[e].line);
+         B.end   = I.entries[e].end;
+         if (chrom == spec_chrom or spec_chrom == "all") {
+            FOUND     = 1;
+            if (seen.find(chrom) != seen.end()) {
+               FALLBACK[chrom] = 1; //chromosome shows up twice in this file, not sorted
+            }
+            seen[chrom]    = 1;
+            BLOCKS[chrom].push_back(B);
+         }
+      }
+      line_number += I.lines;
+   }
+   return -1;
+}
+
 vector<segment*> load::load_bedgraphs_total(string forward_strand,
       string reverse_strand, string joint_bedgraph, int BINS, double scale, string spec_chrom, map<string, int>& chromosomes
       , map<int, string>& ID_to_chrom) {
+   return load_bedgraphs_total(forward_strand, reverse_strand, joint_bedgraph, BINS, scale, spec_chrom,
+                               chromosomes, ID_to_chrom, NULL);
+}
+
+//spill (-mem_budget) takes each chromosome as soon as it is binned, .tfb input is
+//mapped from its file anyway
+vector<segment*> load::load_bedgraphs_total(string forward_strand,
+      string reverse_strand, string joint_bedgraph, int BINS, double scale, string spec_chrom, map<string, int>& chromosomes
+      , map<int, string>& ID_to_chrom, coverage_spill * spill) {
+   if (forward_strand.empty() and reverse_strand.empty() and is_binned_cache(joint_bedgraph)) {
+      return load_binned_cache(joint_bedgraph, BINS, scale, spec_chrom, chromosomes, ID_to_chrom);
+   }
    int FOUND   = 0;
    if (spec_chrom == "all") {
       FOUND   = 1;
    }
-   map<string, segment*>   G;
+   map<string, vector<bedgraph_block> > BLOCKS;
+   map<string, int> FALLBACK;
    vector<segment*> segments;
    vector<string> FILES;
    if (forward_strand.empty() and reverse_strand.empty()) {
@@ -454,94 +1119,355 @@ vector<segment*> load::load_bedgraphs_total(string forward_strand,
    } else if (not forward_strand.empty() and not reverse_strand.empty()) {
       FILES   = {forward_strand, reverse_strand};
    }
+   if (not FILES.empty() and is_bigwig(FILES[0])) {
+      return load_bigwigs_total(FILES, BINS, scale, spec_chrom, chromosomes, ID_to_chrom, spill);
+   }
 
-   string line, chrom;
-   int start, stop;
-   double coverage;
-   vector<string> lineArray;
-   segment * S = NULL;
-   int EXIT    = 0;
-   int line_number = 0;
-   for (int u = 0 ; u < FILES.size(); u++) {
-      int INSERT     = 0;
-      string prevChrom = "";
-      ifstream FH(FILES[u]) ;
-      if (not FH ) {
-         printf("couln't open FILE %s\n", FILES[u].c_str());
+   mapped_file * MF  = new mapped_file[FILES.size()];
+   vector<int> first_line(FILES.size(), 0);
+   int closed  = find_bedgraph_blocks(FILES, MF, spec_chrom, BLOCKS, FALLBACK, first_line, FOUND);
+   if (closed >= 0) {
+      printf("couln't open FILE %s\n", FILES[closed].c_str());
+      delete [] MF;
+      return segments;
+   }
+   for (int u = 0; u < FILES.size(); u++) {
+      if (MF[u].corrupt) {
+         printf("\ncorrupt compressed data in %s\n", FILES[u].c_str());
+         delete [] MF;
+         return segments;
+      }
+   }
+   //(2) every chromosome is parsed and binned on its own thread
+   vector<string> chroms;
+   typedef map<string, vector<bedgraph_block> >::iterator it_type;
+   for (it_type i = BLOCKS.begin(); i != BLOCKS.end(); i++) {
+      chroms.push_back(i->first);
+   }
+   int NC  = chroms.size();
+   vector<segment *> G(NC, (segment *)NULL);
+   vector<int> bad(NC, -1);
+   #pragma omp parallel for schedule(dynamic)
+   for (int t = 0; t < NC; t++) {
+      G[t]  = load_bedgraph_chromosome(MF, chroms[t], BLOCKS[chroms[t]],
+                                       FALLBACK.find(chroms[t]) != FALLBACK.end(), BINS, scale, bad[t]);
+      if (spill != NULL and G[t] != NULL) {
+         spill->add(G[t]);
+      }
+   }
+   int EXIT        = 0;
+   int bad_line    = -1, bad_file = 0;
+   for (int u = 0; u < FILES.size(); u++) {
+      if (MF[u].corrupt) { //only found now when the index was current
+         printf("\ncorrupt compressed data in %s\n", FILES[u].c_str());
+         EXIT      = 1;
       }
-      if (EXIT) {
+   }
+   for (int t = 0; t < NC and not EXIT; t++) {
+      if (bad[t] >= 0 and (bad_line < 0 or bad[t] < bad_line)) {
+         bad_line  = bad[t];
+         EXIT      = 1;
+      }
+   }
+   for (int u = 1; u < FILES.size(); u++) {
+      if (bad_line >= first_line[u]) {
+         bad_file  = u;
+      }
+   }
+   if (bad_line >= 0) {
+      printf("\nLine number %d  in file %s was not formatted properly\nPlease see manual\n", bad_line, FILES[bad_file].c_str() );
+   }
+   if (not EXIT) {
+      for (int i = 0; i < NC; i++) {
+         G[i]->chrom_ID  = CONTIGS.intern(G[i]->chrom);
+         chromosomes[G[i]->chrom] = G[i]->chrom_ID;
+         ID_to_chrom[G[i]->chrom_ID]  = G[i]->chrom;
+         segments.push_back(G[i]);
+      }
+   } else {
+      for (int i = 0; i < NC; i++) {
+         delete G[i];
+      }
+   }
+   delete [] MF;
+   if (not FOUND) {
+      segments.clear();
+      printf("couldn't find chromosome %s in bedgraph files\n", spec_chrom.c_str());
+   }
+   return segments;
+}
+//================================================================================================
+//-tile, windowed reading of bedgraph files
+
+bedgraph_tiles::bedgraph_tiles() {
+   MF  = NULL;
+   bad_line  = -1, unsorted = false;
+}
+bedgraph_tiles::~bedgraph_tiles() {
+   for (int b = 0; b < R.size(); b++) {
+      delete R[b];
+   }
+   if (MF != NULL) {
+      delete [] MF;
+   }
+}
+
+//false if the input isn't bedgraph (bigWig and .tfb files are read by
+//load_bedgraphs_total), can't be read or the chromosome wasn't found
+bool bedgraph_tiles::open(vector<string> files, string spec_chrom, int br, double ns, int tile, int halo) {
+   FILES   = files;
+   BINS    = br, scale = ns, TILE = tile, HALO = halo;
+   if (FILES.empty() or is_bigwig(FILES[0]) or is_binned_cache(FILES[0])) {
+      return false;
+   }
+   int FOUND   = (spec_chrom == "all");
+   vector<int> first_line(FILES.size(), 0);
+   MF  = new mapped_file[FILES.size()];
+   if (find_bedgraph_blocks(FILES, MF, spec_chrom, BLOCKS, FALLBACK, first_line, FOUND) >= 0) {
+      return false; //load_bedgraphs_total reports it
+   }
+   for (int u = 0; u < FILES.size(); u++) {
+      if (MF[u].corrupt) {
+         return false; //load_bedgraphs_total reports it
+      }
+   }
+   return FOUND and not BLOCKS.empty();
+}
+
+vector<string> bedgraph_tiles::chromosomes() {
+   vector<string> chroms;
+   typedef map<string, vector<bedgraph_block> >::iterator it_type;
+   for (it_type i = BLOCKS.begin(); i != BLOCKS.end(); i++) {
+      chroms.push_back(i->first);
+   }
+   return chroms;
+}
+
+//reads the next run of the block into look
+bool bedgraph_tiles::advance(tile_cursor & c) {
+   text_field F[4];
+   int st, sp;
+   double coverage;
+   c.has_look  = false;
+   bool parsed = true;
+   while (c.L.next()) {
+      if (not parse_bedgraph(c.L, F, st, sp, coverage)) {
+         parsed  = false;
          break;
       }
-      while (getline(FH, line)) {
-         lineArray=splitter(line, "\t");
-         //lineArray = string_split(line, '\t');
-         if (lineArray.size() != 4) {
-            EXIT  = 1;
-            printf("\nLine number %d  in file %s was not formatted properly\nPlease see manual\n", line_number, FILES[u].c_str() );
-            break;
-         }
-         line_number++;
-         chrom = lineArray[0], start = stoi(lineArray[1]), stop = stoi(lineArray[2]), coverage = (stof(lineArray[3]));
-         if (chrom != prevChrom and (chrom == spec_chrom or spec_chrom == "all")  )  {
-            FOUND     = 1;
-            if (chrom.size() < 6) {
-               INSERT          = 1;
-               FOUND           = 1;
-            }
-            if (chrom.size() < 6 and u == 0) {
-               G[chrom]  = new segment(chrom, start, stop );
-               INSERT    = 1;
-               FOUND     = 1;
-            } else if (chrom.size() > 6) {
-               INSERT    = 0;
-            }
-         }
-         if (FOUND and chrom != spec_chrom and spec_chrom != "all") {
-            break;
-         }
-         if (INSERT) {
-            if (u == 0) {
-               if (coverage > 0) {
-                  for (int xx = start; xx < stop; xx++) {
-                     G[chrom]->add2(1, double(xx), abs(coverage));
-                  }
-               } else {
-                  for (int xx = start; xx < stop; xx++) {
-                     G[chrom]->add2(-1, double(xx), abs(coverage));
-                  }
-               }
+      c.line++;
+      if (sp > st) {
+         coverage      = float(coverage);
+         c.look        = coverage_run(st, sp, abs(coverage));
+         c.look_strand = (c.u == 0 and coverage > 0) ? 0 : 1;
+         c.has_look    = true;
+         return true;
+      }
+   }
+   if (MF[c.u].corrupt) {
+      bad_line  = c.line;
+      printf("\ncorrupt compressed data in %s\n", FILES[c.u].c_str());
+      return false;
+   }
+   if (not parsed) {
+      bad_line  = c.line;
+      printf("\nLine number %d  in file %s was not formatted properly\nPlease see manual\n", c.line, FILES[c.u].c_str() );
+      return false;
+   }
+   return true;
+}
+
+//false if the chromosome can't be streamed (unsorted), use whole() then. A first pass
+//over the lines leaves the chromosome wide N, fN, rN and extent (-ns scale, from 0)
+//in S, the background every window is tested against
+bool bedgraph_tiles::start(string c, segment * S) {
+   chrom     = c;
+   unsorted  = false;
+   bad_line  = -1;
+   C.clear();
+   for (int b = 0; b < R.size(); b++) {
+      delete R[b];
+   }
+   R.clear();
+   pending[0].clear(), pending[1].clear();
+   if (FALLBACK.find(chrom) != FALLBACK.end()) {
+      unsorted  = true;
+      return false;
+   }
+   vector<bedgraph_block> & B  = BLOCKS[chrom];
+   text_field F[4];
+   int st, sp, lo = -1, hi = -1;
+   double coverage;
+   S->fN = 0, S->rN = 0;
+   text_reader first_pass;
+   for (int b = 0; b < B.size(); b++) {
+      first_pass.open(&MF[B[b].u], B[b].begin, B[b].end);
+      line_scanner L(&first_pass);
+      while (L.next()) {
+         if (parse_bedgraph(L, F, st, sp, coverage) and sp > st) {
+            coverage  = float(coverage);
+            if ((B[b].u == 0 and coverage > 0)) {
+               S->fN  += coverage * (sp - st);
             } else {
-               for (int xx = start; xx < stop; xx++) {
-                  G[chrom]->add2(-1, double(xx), abs(coverage));
-               }
+               S->rN  += abs(coverage) * (sp - st);
             }
+            lo  = (lo < 0 or st < lo) ? st : lo;
+            hi  = max(hi, sp - 1);
          }
-         prevChrom = chrom;
+      }
+   }
+   S->N      = S->fN + S->rN;
+   S->start  = lo, S->stop = hi;
+   origin    = lo, last = hi;
+   S->minX   = 0, S->maxX = (hi - lo) / scale;
+   ws  = -1;
+   for (int b = 0; b < B.size(); b++) {
+      tile_cursor T;
+      R.push_back(new text_reader);
+      R.back()->open(&MF[B[b].u], B[b].begin, B[b].end);
+      T.L     = line_scanner(R.back());
+      T.u     = B[b].u, T.line = B[b].line;
+      if (not advance(T)) {
+         return false;
+      }
+      if (T.has_look and (ws < 0 or T.look.start < ws)) {
+         ws  = T.look.start;
+      }
+      C.push_back(T);
+   }
+   return true;
+}
 
+//the next window of the chromosome, binned like load_bedgraphs_total would;
+//[core_start, core_stop) is the part of it the window is responsible for, the
+//rest is halo. NULL when the chromosome is done (or unsorted/bad_line is set)
+segment * bedgraph_tiles::next(int & core_start, int & core_stop) {
+   if (bad_line >= 0 or unsorted) {
+      return NULL;
+   }
+   int first = -1;
+   for (int b = 0; b < C.size(); b++) {
+      if (C[b].has_look and (first < 0 or C[b].look.start < first)) {
+         first = C[b].look.start;
       }
    }
-   if (not EXIT) {
-      int c = 1;
-      typedef map<string, segment*>::iterator it_type;
-      for (it_type i = G.begin(); i != G.end(); i++) {
-         i->second->bin(BINS, scale, 0);
-         if (chromosomes.find(i->second->chrom) == chromosomes.end()) {
-            chromosomes[i->second->chrom] = c;
-            ID_to_chrom[c]  = i->second->chrom;
-            c++;
+   bool reaching = false; //anything held still reaching into this window's core
+   for (int s = 0; s < 2; s++) {
+      for (int i = 0; i < pending[s].size(); i++) {
+         reaching  = reaching or pending[s][i].stop > ws;
+      }
+   }
+   if (not reaching) {
+      if (first < 0) {
+         return NULL;
+      }
+      if (first >= ws + TILE) { //nothing in between, skip ahead
+         ws  += ((first - ws) / TILE) * TILE;
+      }
+   }
+   //whole chromosomes are binned from their first to their last base, so are the windows
+   int lo  = max(ws - HALO, origin), hi = min(ws + TILE + HALO, last + 1);
+   for (int b = 0; b < C.size(); b++) {
+      tile_cursor & T = C[b];
+      while (T.has_look and T.look.start < hi) {
+         int prev  = T.look.start;
+         pending[T.look_strand].push_back(T.look);
+         if (not advance(T)) {
+            return NULL;
+         }
+         if (T.has_look and T.look.start < prev) {
+            unsorted  = true;
+            return NULL;
          }
-         segments.push_back(i->second);
       }
    }
-   if (not FOUND) {
-      segments.clear();
-      printf("couldn't find chromosome %s in bedgraph files\n", spec_chrom.c_str());
+   segment * S   = new segment(chrom, lo, hi);
+   S->chrom_ID   = CONTIGS.find(chrom);
+   for (int s = 0; s < 2; s++) {
+      for (int i = 0; i < pending[s].size(); i++) {
+         S->add_run(s == 0 ? 1 : -1, max(pending[s][i].start, lo), min(pending[s][i].stop, hi), pending[s][i].coverage);
+      }
    }
-   return segments;
+   S->minX   = lo, S->maxX = hi - 1;
+   S->bin(BINS, scale, 0);
+   core_start  = ws, core_stop = ws + TILE;
+   ws          += TILE;
+   //only runs reaching into the next window's halo are kept
+   for (int s = 0; s < 2; s++) {
+      vector<coverage_run> keep;
+      for (int i = 0; i < pending[s].size(); i++) {
+         if (pending[s][i].stop > ws - HALO) {
+            keep.push_back(pending[s][i]);
+         }
+      }
+      pending[s].swap(keep);
+   }
+   return S;
 }
+
+//the chromosome in one piece, as load_bedgraphs_total reads it
+segment * bedgraph_tiles::whole() {
+   int bad   = -1;
+   segment * S   = load_bedgraph_chromosome(MF, chrom, BLOCKS[chrom],
+                                            FALLBACK.find(chrom) != FALLBACK.end(), BINS, scale, bad);
+   for (int u = 0; u < FILES.size(); u++) {
+      if (MF[u].corrupt) {
+         printf("\ncorrupt compressed data in %s\n", FILES[u].c_str());
+         bad_line  = max(bad, 0);
+         delete S;
+         return NULL;
+      }
+   }
+   if (bad >= 0) {
+      bad_line  = bad;
+      printf("\nLine number %d  (%s) was not formatted properly\nPlease see manual\n", bad, chrom.c_str() );
+   }
+   if (S != NULL) {
+      S->chrom_ID = CONTIGS.find(chrom); //bidir_run interned every chromosome
+   }
+   return S;
+}
+
+//one chromosome in one piece, thread safe with respect to everything but this object
+segment * bedgraph_tiles::load(string c) {
+   chrom   = c;
+   return whole();
+}
+
+segment_queue::segment_queue(int n) {
+   capacity  = n, closed = false;
+}
+
+void segment_queue::push(segment * S) {
+   unique_lock<mutex> lock(m);
+   cv.wait(lock, [this] { return Q.size() < capacity; });
+   Q.push_back(S);
+   cv.notify_all();
+}
+
+//ok is false once the queue is closed and drained
+segment * segment_queue::pop(bool & ok) {
+   unique_lock<mutex> lock(m);
+   cv.wait(lock, [this] { return not Q.empty() or closed; });
+   ok  = not Q.empty();
+   if (not ok) {
+      return NULL;
+   }
+   segment * S   = Q.front();
+   Q.pop_front();
+   cv.notify_all();
+   return S;
+}
+
+void segment_queue::close() {
+   unique_lock<mutex> lock(m);
+   closed  = true;
+   cv.notify_all();
+}
+
 vector<segment*> load::load_intervals_of_interest(string FILE, map<int, string>&  IDS,
       params * P, int center) {
-   ifstream FH(FILE);
+   mapped_file MF;
 
    string spec_chrom   = P->p["-chr"];
    int pad           = stoi(P->p["-pad"]) + 1;
@@ -552,49 +1478,50 @@ vector<segment*> load::load_intervals_of_interest(string FILE, map<int, string>&
    map<int, string> IDS_first;
    int T   = 0;
    int EXIT    = 0;
-   if (FH) {
-      string line, chrom;
-      int start, stop;
+   if (MF.open(FILE)) {
+      string chrom, ID;
+      int start, stop, a, b;
       int   i = 0;
-      vector<string> lineArray;
+      text_field F[5];
+      int NF;
       string strand;
       int PASSED  = 1;
-
-      while (getline(FH, line)) {
-         //lineArray=splitter(line, "\t");
-         lineArray = string_split(line, '\t');
-         if (lineArray[0].substr(0, 1) != "#" and lineArray.size() > 2) {
-            if (lineArray.size() > 3) {
-               if (not check_ID_name(lineArray[3]) and PASSED ) {
+      text_reader R(&MF);
+      line_scanner L(&R);
+
+      while (L.next()) {
+         NF = L.split('\t', F, 5);
+         if (not (F[0].n > 0 and F[0].s[0] == '#') and NF > 2) {
+            if (NF > 3) {
+               ID    = F[3].str();
+               if (not check_ID_name(ID) and PASSED ) {
                   PASSED      = 0;
-                  printf("\ninterval id in line: %s, contains a | symbol changing to :: -> %s\n", line.c_str(), lineArray[3].c_str() );
+                  printf("\ninterval id in line: %s, contains a | symbol changing to :: -> %s\n", L.str().c_str(), ID.c_str() );
                   printf("Will continue to change other occurrences....\n");
 
                }
-               IDS_first[i]    = lineArray[3];
+               IDS_first[i]    = ID;
             } else {
                IDS_first[i]    = "Entry_" + to_string(i + 1);
             }
-            if (lineArray.size() > 4) {
-               strand    = lineArray[4];
+            if (NF > 4) {
+               strand    = F[4].str();
             } else {
                strand    = ".";
             }
-            try {
-               if (not center) {
-                  chrom = lineArray[0], start = max(stoi(lineArray[1]) - pad, 0), stop = stoi(lineArray[2]) + pad;
-               } else {
-                  int x   =   ((stoi(lineArray[1]) + stoi(lineArray[2]))) / 2.;
-                  start     = max(x - pad, 0) , stop  = x + pad;
-                  chrom = lineArray[0];
-               }
-            }
-            catch (exception& e) {
+            if (not parse_int(F[1], a) or not parse_int(F[2], b)) {
                printf("\n\nIssue with file %s at line %d\nPlease consult manual on file format\n\n", FILE.c_str(), i );
                EXIT = 1;
                GS.clear();
                break;
             }
+            chrom = F[0].str();
+            if (not center) {
+               start = max(a - pad, 0), stop = b + pad;
+            } else {
+               int x   =   ((a + b)) / 2.;
+               start     = max(x - pad, 0) , stop  = x + pad;
+            }
             if (start < stop) {
                if (spec_chrom == "all" or spec_chrom == chrom) {
                   segment * S   = new segment(chrom, start, stop, i, strand);
@@ -604,6 +1531,10 @@ vector<segment*> load::load_intervals_of_interest(string FILE, map<int, string>&
             }
          }
       }
+      if (MF.corrupt) {
+         printf("\ncorrupt compressed data in %s\n", FILE.c_str());
+         EXIT  = 1;
+      }
    } else {
       printf("couldn't open %s for reading\n", FILE.c_str() );
       EXIT  = 1;
@@ -625,14 +1556,14 @@ vector<segment*> load::load_intervals_of_interest(string FILE, map<int, string>&
 }
 
 vector<segment* > load::insert_bedgraph_to_segment_joint(map<string, vector<segment *> > A ,
-      string forward, string reverse, string joint, int rank ) {
+      string forward, string reverse, string joint, int rank, int BINS, double scale ) {
 
 
 
-   map<string, node> NT;
+   map<string, interval_sweep> NT;
    typedef map<string, vector<segment *> >::iterator it_type_5;
    for (it_type_5 c = A.begin(); c != A.end(); c++) {
-      NT[c->first]  = node(c->second);
+      NT[c->first]  = interval_sweep(c->second);
    }
    int start, stop, N, j;
    double coverage;
@@ -649,40 +1580,55 @@ vector<segment* > load::insert_bedgraph_to_segment_joint(map<string, vector<segm
    } else if (not forward.empty() and not reverse.empty()) {
       FILES   = {forward, reverse};
    }
+   if (not FILES.empty() and is_bigwig(FILES[0])) {
+      if (not insert_bigwigs(FILES, A, NT)) {
+         return segments;
+      }
+      FILES.clear();
+   }
+   if (forward.empty() and reverse.empty() and is_binned_cache(joint)) {
+      FILES.clear();
+      if (not insert_binned_cache(joint, NT, BINS, scale)) {
+         return segments;
+      }
+   }
    string FILE;
+   text_field F[4];
    for (int i = 0; i < FILES.size(); i++) {
       FILE = FILES[i];
-      ifstream FH(FILE);
-      if (FH) {
+      mapped_file MF;
+      if (MF.open(FILE)) {
          prevchrom = "";
-         while (getline(FH, line)) {
-            //lineArray   = splitter2(line, "\t");
-            lineArray       = string_split(line, '\t');
-            if (lineArray.size() == 4) {
-               chrom     = lineArray[0];
-               start = stoi(lineArray[1]), stop = stoi(lineArray[2]), coverage = stod(lineArray[3]);
+         interval_sweep * T  = NULL;
+         text_reader R(&MF);
+         line_scanner L(&R);
+         while (L.next()) {
+            if (parse_bedgraph(L, F, start, stop, coverage)) {
                if (coverage > 0 and i == 0) {
                   strand  = 1;
                } else if (coverage < 0 or i == 1) {
                   strand  = -1;
                }
-               center  = (stop + start) / 2.;
-               if (NT.find(chrom) != NT.end()) {
-                  for (int center_2 = start; center_2 < stop; center_2++) {
-                     vector<double> x(2);
-                     x[0] = double(center_2), x[1] = abs(coverage);
-                     NT[chrom].insert_coverage(x, strand);
-                  }
-
+               if (not F[0].equals(prevchrom)) {
+                  prevchrom = F[0].str();
+                  T         = (NT.find(prevchrom) != NT.end()) ? &NT[prevchrom] : NULL;
+               }
+               if (T != NULL) {
+                  T->add(strand, start, stop, abs(coverage));
                }
             }
             else {
-               printf("\n***error in line: %s, not bedgraph formatted\n", line.c_str() );
+               printf("\n***error in line: %s, not bedgraph formatted\n", L.str().c_str() );
                segments.clear();
                return segments;
             }
          }
-         FH.close();
+         if (MF.corrupt) {
+            printf("\ncorrupt compressed data in %s\n", FILE.c_str());
+            segments.clear();
+            return segments;
+         }
+         MF.close();
 
       } else {
          cout << "could not open forward bedgraph file: " << FILE << endl;
@@ -692,13 +1638,33 @@ vector<segment* > load::insert_bedgraph_to_segment_joint(map<string, vector<segm
    }
    //now we want to get all the intervals and make a vector<segment *> again...
    vector<segment *>NS;
-   typedef map<string, node>::iterator it_type_6;
-   for (it_type_6 c = NT.begin(); c != NT.end(); c++) {
-      c->second.retrieve_nodes(NS);
+   for (it_type_5 c = A.begin(); c != A.end(); c++) {
+      NS.insert(NS.end(), c->second.begin(), c->second.end());
    }
 
    return NS;
 }
+//same as insert_bedgraph_to_segment_joint but served from segments load_bedgraphs_total
+//already binned, so the bedgraph files aren't read a second time
+vector<segment* > load::insert_binned_segments(map<string, vector<segment *> > A,
+      vector<segment *> coverage, int BINS) {
+   map<string, interval_sweep> NT;
+   typedef map<string, vector<segment *> >::iterator it_type_5;
+   for (it_type_5 c = A.begin(); c != A.end(); c++) {
+      NT[c->first]  = interval_sweep(c->second);
+   }
+   for (int i = 0; i < coverage.size(); i++) {
+      segment * S   = coverage[i];
+      if (NT.find(S->chrom) != NT.end()) {
+         NT[S->chrom].add_bins(S->start, S->XN, BINS, S->X.fwd, S->X.rev);
+      }
+   }
+   vector<segment *>NS;
+   for (it_type_5 c = A.begin(); c != A.end(); c++) {
+      NS.insert(NS.end(), c->second.begin(), c->second.end());
+   }
+   return NS;
+}
 vector<segment_fits *> load::load_K_models_out(string FILE) {
    ifstream FH(FILE);
    string line;
@@ -792,6 +1758,31 @@ void load::write_out_bidirs(map<string , vector<vector<double> > > G, string out
 }
 
 
+//the intervals load_intervals_of_interest would read back out of the
+//_prelim_bidir_hits.bed written by write_out_bidirs (same IDs, same -pad)
+vector<segment *> load::intervals_from_bidirs(map<string , vector<vector<double> > > G,
+      map<int, string>& IDS, params * P) {
+   string spec_chrom   = P->p["-chr"];
+   int pad           = stoi(P->p["-pad"]) + 1;
+   vector<segment *> FSI;
+   int i   = 0;
+   typedef map<string , vector<vector<double> > >::iterator it_type;
+   for (it_type c = G.begin(); c != G.end(); c++) {
+      vector<vector<double>> data_intervals   =  bubble_sort_alg(c->second);
+      for (int j = 0; j < data_intervals.size(); j++) {
+         int start   = max(int(data_intervals[j][0]) - pad, 0), stop = int(data_intervals[j][1]) + pad;
+         if (start < stop) {
+            IDS[i]    = "ME_" + to_string(i);
+            if (spec_chrom == "all" or spec_chrom == c->first) {
+               FSI.push_back(new segment(c->first, start, stop, i, "."));
+            }
+            i++;
+         }
+      }
+   }
+   return FSI;
+}
+
 void load::write_out_models_from_free_mode(map<int, map<int, vector<simple_c_free_mode>  > > G,
       params * P, int job_ID, map<int, string> IDS, int noise, string & file_name) {
 
@@ -828,7 +1819,7 @@ void load::write_out_models_from_free_mode(map<int, map<int, vector<simple_c_fre
       FHW << ">" + IDS[s->first] + "|";
       for (it_type_2 k  = s->second.begin(); k != s->second.end(); k++) { //iterate over each model_complexity
          for (it_type_3 c = k->second.begin(); c != k->second.end(); c++) {
-            chrom     = (*c).chrom;
+            chrom     = CONTIGS.name((*c).chrom_ID);
             INFO    = chrom + ":" + to_string((*c).ID[1]) + "-" + to_string((*c).ID[2]);
             pos     = to_string((*c).SS[1]);
             neg     = to_string((*c).SS[2]);
@@ -845,7 +1836,7 @@ void load::write_out_models_from_free_mode(map<int, map<int, vector<simple_c_fre
          int NN      = k->second.size();
          int ii      = 0;
          for (it_type_3 c = k->second.begin(); c != k->second.end(); c++) {
-            chrom     = (*c).chrom;
+            chrom     = CONTIGS.name((*c).chrom_ID);
             start     = (*c).ID[1];
             mu      = to_string((*c).ps[0] * scale + (*c).ID[1] );
             sigma     = to_string((*c).ps[1] * scale);
@@ -906,7 +1897,8 @@ void load::write_out_bidirectionals_ms_pen(vector<segment_fits*> fits, params *
 //misc.
 void load::BIN(vector<segment*> segments, int BINS, double scale, int erase) {
    for (int i = 0 ; i < segments.size() ; i ++) {
-      if (segments[i]->forward.size() > 0 or segments[i]->reverse.size() > 0 ) {
+      if (segments[i]->forward.size() > 0 or segments[i]->reverse.size() > 0
+            or segments[i]->forward_runs.size() > 0 or segments[i]->reverse_runs.size() > 0 ) {
          segments[i]->bin(BINS, scale, erase);
       }
    }
@@ -953,18 +1945,21 @@ void load::clear_segments(vector<segment *> segments) {
 }
 vector<segment_fits *> load::label_tss(string tss_file, vector<segment_fits *> query_fits ) {
    vector<segment_fits *> new_fits;
-   ifstream FH(tss_file);
-   string line;
+   mapped_file MF;
    map<string, vector<segment *> >G;
    map<string, node> T;
-   string chrom, start, stop;
+   int start, stop;
+   text_field F[3];
    typedef map<string, vector<segment *>>::iterator it_type;
-   if (FH) {
-      while (getline(FH, line)) {
-         vector<string> lineArray  = split_by_tab(line, "");
-         chrom   = lineArray[0], start = lineArray[1], stop = lineArray[2];
-         segment * S   = new segment(chrom, stoi(start), stoi(stop));
-         G[chrom].push_back(S);
+   if (MF.open(tss_file)) {
+      text_reader R(&MF);
+      line_scanner L(&R);
+      while (L.next()) {
+         if (L.split('\t', F, 3) < 3 or not parse_int(F[1], start) or not parse_int(F[2], stop)) {
+            continue;
+         }
+         segment * S   = new segment(F[0].str(), start, stop);
+         G[S->chrom].push_back(S);
       }
       //make G a node interval tree
       for (it_type c = G.begin(); c != G.end(); c++) {
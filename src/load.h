@@ -3,7 +3,11 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
 #include "read_in_parameters.h"
+#include "mmap_reader.h"
 using namespace std;
 class simple_c_free_mode;
 
@@ -11,8 +15,77 @@ class simple_c_free_mode;
 
 
 class classifier; //forward declare
+class coverage_spill;
 
+class coverage_run{ //one bedgraph line, [start, stop) at a constant coverage
+public:
+	int start, stop;
+	double coverage;
+	coverage_run();
+	coverage_run(int, int, double);
+};
+
+//read only view of binned coverage, what the scanning and EM kernels take
+class coverage_view{
+public:
+	const double * pos; //bin positions (on the -ns scale), NULL on an implicit grid
+	const float * fwd;  //forward strand coverage per bin
+	const float * rev;  //reverse strand coverage per bin
+	int n;
+	double delta, scale; //implicit grid: bin i sits at i * delta / scale
+	double x(int i) const { return pos != NULL ? pos[i] : (i * delta) / scale; }
+};
+
+//binned coverage of a segment: positions and both strands in one 64 byte aligned
+//allocation (pos | fwd | rev) that is freed with the segment; borrow() points it
+//at memory it doesn't own instead (a mapped binned cache file). Dense segments
+//whose positions are exactly i * delta / scale drop pos (to_grid)
+class coverage_block{
+public:
+	double * pos;
+	float * fwd;
+	float * rev;
+	int n;
+	double delta, scale;
+	coverage_block();
+	~coverage_block();
+	coverage_block(const coverage_block &) = delete;
+	coverage_block & operator=(const coverage_block &) = delete;
+	void allocate(int);
+	void allocate_grid(int, double, double);
+	void borrow(double *, float *, float *, int);
+	bool to_grid(double, double);
+	void release();
+	void swap(coverage_block &);
+	void place();
+	coverage_view view() const;
+private:
+	void * owned;
+};
+
+//chromosome / contig names interned to integer IDs (from 1, 0 is unknown), so
+//MPI messages and model output structs carry an int instead of a truncated name;
+//MPI_comm::send_out_contigs gives every rank the table of rank 0
+class contig_dictionary{
+public:
+	vector<string> names;
+	int intern(string);
+	int find(string) const;
+	string name(int) const;
+private:
+	map<string, int> IDS;
+};
+extern contig_dictionary CONTIGS;
 
+//block sums of binned coverage, one level per block width (in bins); lets a scan
+//bound the coverage of a stretch without visiting its bins
+class coverage_pyramid{
+public:
+	vector<int> width;
+	vector<vector<double> > fwd, rev;
+	coverage_pyramid(coverage_view, vector<int>);
+	double sum(int, int, int, int) const;
+};
 
 class segment{
 public:
@@ -21,6 +94,8 @@ public:
 	double minX, maxX;
 	vector< vector<double> > forward;
 	vector< vector<double> > reverse;
+	vector<coverage_run> forward_runs;
+	vector<coverage_run> reverse_runs;
 	string strand ;
 	int counts;
 	vector<double> centers;
@@ -33,11 +108,19 @@ public:
 	string write_out();
 	void bin(double, double, int);
 	void add2(int, double, double);
+	void add_run(int, int, int, double);
+	bool stream_add(int, int, int, double, int);
+	void stream_bin(double, double, int);
+	void scale_bins(double, int);
+	int streaming;
+	vector<double> stream_forward;
+	vector<double> stream_reverse;
 	double N;
 	double fN;
 	double rN;
 	double XN;
-	double ** X;
+	coverage_block X;
+	coverage_view view() const;
 	double SCALE;
 	vector<vector<double> > bidirectional_bounds;
 	vector<segment *> bidirectional_data;
@@ -60,6 +143,88 @@ public:
 	void searchInterval(int, int, vector<int> &) ;
 };
 
+//joins the coverage runs of one chromosome into the intervals they overlap
+//(bases strictly inside start/stop, like node::insert_coverage); runs normally
+//arrive sorted by start, one that doesn't restarts the sweep at the first
+//interval that can still reach it (binary search over reach)
+class interval_sweep{
+public:
+	vector<segment *> S; //sorted by start
+	vector<int> reach;   //largest stop of S[0..i]
+	vector<segment *> active;
+	int next, last;
+	interval_sweep();
+	interval_sweep(vector<segment *>);
+	void add(int, int, int, double);
+	void add_bins(int, long, int, const float *, const float *);
+};
+
+//a run of consecutive lines of one chromosome in one of the bedgraph files
+class bedgraph_block{
+public:
+	int u;            //which file
+	long begin, end;  //byte range in the mapped file
+	int line;         //line number of the first line
+	bedgraph_block(int, long, int);
+};
+
+//one block of the chromosome bedgraph_tiles is reading
+class tile_cursor{
+public:
+	line_scanner L; //reads through a text_reader of bedgraph_tiles::R
+	int u, line;
+	bool has_look;  //look is the next run, not yet in any window
+	int look_strand;
+	coverage_run look;
+};
+
+//-tile: streams the chromosomes of bedgraph files as windows of TILE bases with
+//HALO bases of context on both sides; only the runs reaching into the current
+//window are held, so memory doesn't grow with the chromosome. load() reads one
+//whole chromosome at a time instead
+class bedgraph_tiles{
+public:
+	vector<string> FILES;
+	mapped_file * MF;
+	map<string, vector<bedgraph_block> > BLOCKS;
+	map<string, int> FALLBACK;
+	int BINS, TILE, HALO;
+	double scale;
+	int bad_line;   //>= 0 once a line wasn't bedgraph formatted
+	bool unsorted;  //the chromosome went backwards, it has to be read with whole()
+	bedgraph_tiles();
+	~bedgraph_tiles();
+	bool open(vector<string>, string, int, double, int, int);
+	vector<string> chromosomes();
+	bool start(string, segment *);
+	segment * next(int &, int &);
+	segment * whole();
+	segment * load(string);
+private:
+	string chrom;
+	vector<tile_cursor> C;
+	vector<text_reader *> R;
+	vector<coverage_run> pending[2]; //forward, reverse
+	int ws, origin, last; //window start, first and last base of the chromosome
+	bool advance(tile_cursor &);
+};
+
+//bounded hand off of loaded chromosomes from a reader thread to the scanner,
+//push() waits while the queue is full and pop() while it is empty
+class segment_queue{
+public:
+	segment_queue(int);
+	void push(segment *);
+	segment * pop(bool &);
+	void close();
+private:
+	deque<segment *> Q;
+	int capacity;
+	bool closed;
+	mutex m;
+	condition_variable cv;
+};
+
 class segment_fits{
 public:
 	string chrom;
@@ -88,16 +253,20 @@ namespace load{
 
 	vector<segment*> load_bedgraphs_total(string, 
 		string, string, int , double, string,map<string, int>&,map<int, string>&);
+	vector<segment*> load_bedgraphs_total(string, 
+		string, string, int , double, string,map<string, int>&,map<int, string>&, coverage_spill *);
 
 
 	void write_out_bidirs(map<string , vector<vector<double> > >, string, string, int ,params *, int);
 
 	vector<segment *> load_intervals_of_interest(string,map<int, string>&, params *, int);
+	vector<segment *> intervals_from_bidirs(map<string , vector<vector<double> > >, map<int, string>&, params *);
 
 
 	void collect_all_tmp_files(string , string, int, int );
 	vector<segment* > insert_bedgraph_to_segment_joint(map<string, vector<segment *> >  , 
-		string , string , string ,int);
+		string , string , string ,int, int, double);
+	vector<segment* > insert_binned_segments(map<string, vector<segment *> > , vector<segment *>, int);
 
 	void write_out_models_from_free_mode(map<int, map<int, vector<simple_c_free_mode>  > >,
 		params *,int,map<int, string>, int, string &);
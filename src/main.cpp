@@ -22,6 +22,10 @@
 #include "bidir_main.h"
 #include "model_main.h"
 #include "select_main.h"
+#include "convert_main.h"
+#include "index_main.h"
+#include "thread_placement.h"
+#include "simd_math.h"
 using namespace std;
 
 int main(int argc, char* argv[]){
@@ -42,6 +46,13 @@ int main(int argc, char* argv[]){
     MPI_Finalize();
     return 0;
   }
+  if (P->p["-pin"] != "none" and pin_threads(P->p["-pin"]) == 0 and rank == 0){
+    printf("couldn't pin threads (-pin %s)\n", P->p["-pin"].c_str());
+  }
+  string simd   = set_simd(P->p["-simd"]);
+  if (P->p["-simd"] != "auto" and simd != P->p["-simd"] and rank == 0){
+    printf("this CPU lacks %s, using -simd %s\n", P->p["-simd"].c_str(), simd.c_str());
+  }
   int job_ID 		=  MPI_comm::get_job_ID(P->p["-log_out"], P->p["-N"], rank, nprocs);
   
   int verbose 	= stoi(P->p["-v"]);
@@ -57,6 +68,10 @@ int main(int argc, char* argv[]){
     model_run(P, rank, nprocs,0,job_ID,LG);
   }else if (P->select){
     select_run(P, rank, nprocs, job_ID,LG);	
+  }else if (P->convert){
+    convert_run(P, rank, nprocs, job_ID,LG);
+  }else if (P->index){
+    index_run(P, rank, nprocs, job_ID,LG);
   }
   if (rank == 0){
     load::collect_all_tmp_files(P->p["-log_out"], P->p["-N"], nprocs, job_ID);
@@ -0,0 +1,564 @@
+#include "mmap_reader.h"
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
+#include <algorithm>
+#include <zlib.h>
+using namespace std;
+
+//================================================================================================
+//mapped_file
+
+static const size_t TEXT_PIECE  = 16 << 20;
+static const size_t GZIP_SPAN   = 64 << 20;
+
+mapped_file::mapped_file() {
+	data    = NULL;
+	size    = 0;
+	mapped  = false;
+	format  = TEXT_FILE;
+	corrupt = false;
+}
+mapped_file::~mapped_file() {
+	close();
+}
+
+bool bgzf_members(const unsigned char *, size_t, vector<size_t> &, vector<size_t> &);
+
+//gzip input is only recognized here, it is inflated as it is read
+void find_format(mapped_file & MF) {
+	const unsigned char * d = (const unsigned char *)MF.data;
+	MF.format   = TEXT_FILE;
+	if (MF.size < 2 or d[0] != 0x1f or d[1] != 0x8b) {
+		return;
+	}
+	MF.format   = BGZF_FILE;
+	if (not bgzf_members(d, MF.size, MF.member_in, MF.member_out)) {
+		MF.member_in.clear(), MF.member_out.clear();
+		MF.format   = GZIP_FILE;
+	}
+}
+
+bool mapped_file::open(string FILE) {
+	close();
+	int fd  = ::open(FILE.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) == 0 and S_ISREG(st.st_mode)) {
+		size  = st.st_size;
+		if (size == 0) {
+			::close(fd);
+			return true;
+		}
+		void * m  = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (m != MAP_FAILED) {
+			madvise(m, size, MADV_SEQUENTIAL);
+			data    = (const char *)m;
+			mapped  = true;
+			::close(fd);
+			find_format(*this);
+			return true;
+		}
+	}
+	//not mappable, read it all in
+	size_t cap  = 1 << 20, n = 0;
+	char * buf  = (char *)malloc(cap);
+	ssize_t r;
+	while ((r = read(fd, buf + n, cap - n)) > 0) {
+		n += r;
+		if (n == cap) {
+			cap *= 2;
+			buf = (char *)realloc(buf, cap);
+		}
+	}
+	::close(fd);
+	data  = buf;
+	size  = n;
+	find_format(*this);
+	return r == 0;
+}
+
+void mapped_file::close() {
+	if (data != NULL) {
+		if (mapped) {
+			munmap((void *)data, size);
+		} else {
+			free((void *)data);
+		}
+	}
+	for (int k = 0; k < points.size(); k++) {
+		if (points[k] != NULL) {
+			inflateEnd(&points[k]->z);
+			delete points[k];
+		}
+	}
+	points.clear();
+	member_in.clear(), member_out.clear();
+	data    = NULL;
+	size    = 0;
+	mapped  = false;
+	format  = TEXT_FILE;
+	corrupt = false;
+}
+
+//================================================================================================
+//gzip and BGZF input
+
+unsigned int little_endian_32(const unsigned char * p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+//BGZF members carry their compressed size in a BC extra field and their inflated size
+//in the trailer, so every member can be found and inflated on its own; false if any
+//member isn't BGZF
+bool bgzf_members(const unsigned char * d, size_t n, vector<size_t> & in, vector<size_t> & out) {
+	size_t p      = 0;
+	size_t total  = 0;
+	while (p < n) {
+		if (n - p < 18 or d[p] != 0x1f or d[p + 1] != 0x8b or d[p + 2] != 8 or not (d[p + 3] & 4)) {
+			return false;
+		}
+		size_t xlen   = d[p + 10] | (d[p + 11] << 8);
+		size_t bsize  = 0;
+		for (size_t x = p + 12; x + 4 <= p + 12 + xlen and x + 4 <= n; ) {
+			size_t slen = d[x + 2] | (d[x + 3] << 8);
+			if (d[x] == 'B' and d[x + 1] == 'C' and slen == 2 and x + 6 <= n) {
+				bsize = (d[x + 4] | (d[x + 5] << 8)) + 1;
+			}
+			x += 4 + slen;
+		}
+		if (bsize < 12 + xlen + 8 or p + bsize > n) {
+			return false;
+		}
+		in.push_back(p);
+		out.push_back(total);
+		total += little_endian_32(d + p + bsize - 4);
+		p     += bsize;
+	}
+	in.push_back(n);
+	out.push_back(total);
+	return true;
+}
+
+//members [first, last) into buf, which starts at the inflated offset of first; the
+//members of a batch are inflated in parallel by the OpenMP threads
+bool inflate_bgzf(const unsigned char * d, vector<size_t> & in, vector<size_t> & out,
+                  int first, int last, char * buf) {
+	int failed  = 0;
+	#pragma omp parallel for schedule(dynamic, 16) reduction(||:failed)
+	for (int b = first; b < last; b++) {
+		const unsigned char * block  = d + in[b];
+		size_t xlen   = block[10] | (block[11] << 8);
+		size_t bsize  = in[b + 1] - in[b];
+		char * to     = buf + (out[b] - out[first]);
+		z_stream z;
+		memset(&z, 0, sizeof(z));
+		if (inflateInit2(&z, -15) != Z_OK) {
+			failed  = 1;
+			continue;
+		}
+		z.next_in   = (Bytef *)(block + 12 + xlen);
+		z.avail_in  = bsize - 12 - xlen - 8;
+		z.next_out  = (Bytef *)to;
+		z.avail_out = out[b + 1] - out[b];
+		int r       = inflate(&z, Z_FINISH);
+		inflateEnd(&z);
+		if ((r != Z_STREAM_END and out[b + 1] > out[b]) or z.avail_out != 0
+		        or crc32(0, (Bytef *)to, out[b + 1] - out[b]) != little_endian_32(block + bsize - 8)) {
+			failed  = 1;
+		}
+	}
+	return not failed;
+}
+
+//================================================================================================
+//text_reader
+
+text_reader::text_reader() {
+	MF      = NULL;
+	at      = 0, end = 0;
+	w0      = 0, w1 = 0;
+	eof     = false, started = false;
+	member  = 0;
+	z_open  = false;
+}
+text_reader::text_reader(mapped_file * F) : text_reader() {
+	open(F, 0, TEXT_END);
+}
+text_reader::~text_reader() {
+	if (z_open) {
+		inflateEnd(&z);
+	}
+}
+
+//[begin, end) of the text; TEXT_END reads to the end of the file
+void text_reader::open(mapped_file * F, size_t begin, size_t stop) {
+	if (F != MF) {
+		started   = false;
+	}
+	MF  = F;
+	at  = begin, end = stop;
+	if (MF->format == TEXT_FILE) {
+		end = min(end, MF->size);
+		return;
+	}
+	//what is buffered (or the inflater continuing from it) still serves a range
+	//starting at or after it
+	if (not started or at < w0 or at > w1) {
+		seek();
+	}
+}
+
+//positions the inflater at or before at
+void text_reader::seek() {
+	buf.clear();
+	eof     = false;
+	started = true;
+	if (MF->format == BGZF_FILE) {
+		member  = upper_bound(MF->member_out.begin(), MF->member_out.end(), at) - MF->member_out.begin() - 1;
+		w0      = w1 = MF->member_out[member];
+		return;
+	}
+	lock_guard<mutex> lock(MF->point_lock);
+	int k   = min(int(at / GZIP_SPAN), int(MF->points.size()));
+	while (k > 0 and MF->points[k - 1] == NULL) {
+		k--;
+	}
+	if (z_open and w1 <= at and (k == 0 or MF->points[k - 1]->at <= w1)) {
+		w0  = w1; //already closer than any point
+		return;
+	}
+	if (z_open) {
+		inflateEnd(&z);
+	}
+	z_open  = true;
+	if (k > 0) {
+		inflateCopy(&z, &MF->points[k - 1]->z);
+		w0  = w1 = MF->points[k - 1]->at;
+		return;
+	}
+	memset(&z, 0, sizeof(z));
+	inflateInit2(&z, 15 + 32);
+	z.next_in   = (Bytef *)MF->data;
+	z.avail_in  = MF->size;
+	w0          = w1 = 0;
+}
+
+//appends the next batch of inflated text to buf, false at the end of the file
+bool text_reader::fill() {
+	if (eof) {
+		return false;
+	}
+	size_t old  = buf.size();
+	if (MF->format == BGZF_FILE) {
+		int M     = MF->member_out.size() - 1;
+		int last  = member;
+		while (last < M and MF->member_out[last] - MF->member_out[member] < TEXT_PIECE) {
+			last++;
+		}
+		if (last == member) {
+			eof   = true;
+			return false;
+		}
+		size_t n  = MF->member_out[last] - MF->member_out[member];
+		buf.resize(old + n);
+		if (not inflate_bgzf((const unsigned char *)MF->data, MF->member_in, MF->member_out, member, last,
+		                     buf.data() + old)) {
+			MF->corrupt = true;
+			buf.resize(old);
+			eof   = true;
+			return false;
+		}
+		member  = last;
+		w1      += n;
+		return true;
+	}
+	//stops on the next multiple of GZIP_SPAN, so a point can be left there
+	size_t want = min(TEXT_PIECE, (w1 / GZIP_SPAN + 1) * GZIP_SPAN - w1);
+	buf.resize(old + want);
+	z.next_out  = (Bytef *)(buf.data() + old);
+	z.avail_out = want;
+	while (z.avail_out > 0) {
+		int r = inflate(&z, Z_NO_FLUSH);
+		if (r == Z_STREAM_END) {
+			if (z.avail_in == 0) {
+				eof   = true;
+				break;
+			}
+			inflateReset(&z); //concatenated members
+		} else if (r != Z_OK) {
+			MF->corrupt = true;
+			eof   = true;
+			break;
+		}
+	}
+	size_t n  = want - z.avail_out;
+	buf.resize(old + n);
+	w1        += n;
+	if (not eof and w1 % GZIP_SPAN == 0) {
+		lock_guard<mutex> lock(MF->point_lock);
+		int k   = w1 / GZIP_SPAN - 1;
+		if (k >= MF->points.size()) {
+			MF->points.resize(k + 1, (gzip_point *)NULL);
+		}
+		if (MF->points[k] == NULL) {
+			gzip_point * P  = new gzip_point;
+			P->at           = w1;
+			if (inflateCopy(&P->z, &z) == Z_OK) {
+				MF->points[k] = P;
+			} else {
+				delete P;
+			}
+		}
+	}
+	return n > 0 or not eof;
+}
+
+//the next piece, false once the range (or the file) is done
+bool text_reader::next(const char *& b, const char *& e) {
+	if (MF == NULL or at >= end) {
+		return false;
+	}
+	if (MF->format == TEXT_FILE) {
+		b   = MF->data + at, e = MF->data + end;
+		at  = end;
+		return true;
+	}
+	while (true) {
+		//drops what was handed out (or skipped) already
+		size_t drop = min(at, w1) - w0;
+		if (drop > 0) {
+			buf.erase(buf.begin(), buf.begin() + drop);
+			w0  += drop;
+		}
+		size_t stop = min(end, w1);
+		if (w0 == at and stop > at) {
+			size_t n  = stop - at;
+			if (stop < end and not eof) { //more to come, whole lines of at least a piece only
+				const char * nl = (n >= TEXT_PIECE) ? (const char *)memrchr(buf.data(), '\n', n) : NULL;
+				n   = (nl == NULL) ? 0 : nl + 1 - buf.data();
+			}
+			if (n > 0) {
+				b   = buf.data(), e = b + n;
+				at  += n;
+				return true;
+			}
+		}
+		if (not fill()) {
+			if (eof and w1 <= at) {
+				end = at = max(at, w1);
+				return false;
+			}
+		}
+	}
+}
+
+//offset of the next byte next() hands out, the end of the text once it is done
+size_t text_reader::tell() {
+	return at;
+}
+
+//================================================================================================
+//fields and lines
+
+string text_field::str() {
+	return string(s, n);
+}
+bool text_field::equals(const string & other) {
+	return n == int(other.size()) and memcmp(s, other.data(), n) == 0;
+}
+
+line_scanner::line_scanner() {
+	p = end = line = line_end = piece = NULL;
+	source    = NULL;
+	piece_at  = 0;
+}
+line_scanner::line_scanner(const char * begin, const char * stop) {
+	p     = begin, end = stop;
+	line  = line_end = piece = begin;
+	source    = NULL;
+	piece_at  = 0;
+}
+line_scanner::line_scanner(text_reader * R) : line_scanner() {
+	source    = R;
+}
+
+bool line_scanner::next() {
+	while ((p == NULL or p >= end) and source != NULL) {
+		piece_at  = source->tell();
+		if (not source->next(p, end)) {
+			break;
+		}
+		piece = p;
+	}
+	if (p == NULL or p >= end) {
+		return false;
+	}
+	line              = p;
+	const char * nl   = (const char *)memchr(p, '\n', end - p);
+	if (nl == NULL) {
+		nl  = end;
+	}
+	line_end  = nl;
+	if (line_end > line and *(line_end - 1) == '\r') {
+		line_end--;
+	}
+	p   = (nl < end) ? nl + 1 : end;
+	return true;
+}
+
+//returns the number of fields on the current line, fills at most N of them
+int line_scanner::split(char delim, text_field * F, int N) {
+	int n           = 0;
+	const char * s  = line;
+	while (true) {
+		const char * t  = (const char *)memchr(s, delim, line_end - s);
+		if (t == NULL) {
+			t = line_end;
+		}
+		if (n < N) {
+			F[n].s  = s, F[n].n = t - s;
+		}
+		n++;
+		if (t == line_end) {
+			break;
+		}
+		s   = t + 1;
+	}
+	return n;
+}
+
+string line_scanner::str() {
+	return string(line, line_end - line);
+}
+
+//offset of the current line in the text (of the reader, if there is one)
+size_t line_scanner::offset() {
+	return piece_at + (line - piece);
+}
+
+//================================================================================================
+//numbers, same leniency as stoi/stod (leading blanks, trailing junk ignored)
+
+bool parse_int(text_field F, int & v) {
+	const char * s = F.s, * e = F.s + F.n;
+	while (s < e and (*s == ' ' or *s == '\t')) {
+		s++;
+	}
+	bool neg  = false;
+	if (s < e and (*s == '-' or *s == '+')) {
+		neg = (*s == '-');
+		s++;
+	}
+	if (s == e or *s < '0' or *s > '9') {
+		return false;
+	}
+	long long x = 0;
+	while (s < e and *s >= '0' and *s <= '9') {
+		x = x * 10 + (*s - '0');
+		if (x > 2147483648LL) {
+			return false;
+		}
+		s++;
+	}
+	x   = neg ? -x : x;
+	if (x > 2147483647LL) {
+		return false;
+	}
+	v   = int(x);
+	return true;
+}
+
+static const double POW10[23] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+                                 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+                                };
+
+bool parse_double_slow(text_field F, double & v) {
+	char buf[64];
+	string copy;
+	const char * c;
+	if (F.n < 64) {
+		memcpy(buf, F.s, F.n);
+		buf[F.n] = '\0';
+		c        = buf;
+	} else {
+		copy     = F.str();
+		c        = copy.c_str();
+	}
+	char * stop;
+	v   = strtod(c, &stop);
+	return stop != c;
+}
+
+//up to 15 significant digits and |exponent| <= 22 are converted exactly with a
+//single multiply/divide (correctly rounded), everything else goes to strtod
+bool parse_double(text_field F, double & v) {
+	const char * s = F.s, * e = F.s + F.n;
+	bool neg  = false;
+	if (s < e and (*s == '-' or *s == '+')) {
+		neg = (*s == '-');
+		s++;
+	}
+	unsigned long long m = 0;
+	int digits = 0, scale = 0, any = 0;
+	while (s < e and *s >= '0' and *s <= '9') {
+		if (m or *s != '0') {
+			digits++;
+		}
+		m = m * 10 + (*s - '0'), any = 1;
+		s++;
+	}
+	if (s < e and *s == '.') {
+		s++;
+		while (s < e and *s >= '0' and *s <= '9') {
+			if (m or *s != '0') {
+				digits++;
+			}
+			m = m * 10 + (*s - '0'), any = 1;
+			scale--;
+			s++;
+		}
+	}
+	if (not any or digits > 15) {
+		return parse_double_slow(F, v);
+	}
+	if (s < e and (*s == 'e' or *s == 'E')) {
+		const char * t = s + 1;
+		bool eneg = false;
+		if (t < e and (*t == '-' or *t == '+')) {
+			eneg = (*t == '-');
+			t++;
+		}
+		if (t < e and *t >= '0' and *t <= '9') {
+			int x = 0;
+			while (t < e and *t >= '0' and *t <= '9') {
+				if (x < 10000) {
+					x = x * 10 + (*t - '0');
+				}
+				t++;
+			}
+			scale += eneg ? -x : x;
+		}
+	}
+	if (scale < -22 or scale > 22) {
+		return parse_double_slow(F, v);
+	}
+	v   = (scale >= 0) ? double(m) * POW10[scale] : double(m) / POW10[-scale];
+	v   = neg ? -v : v;
+	return true;
+}
+
+//chromosome[tab]start[tab]stop[tab]coverage, F[0] is left pointing at the chromosome
+bool parse_bedgraph(line_scanner & L, text_field * F, int & start, int & stop, double & coverage) {
+	if (L.split('\t', F, 4) != 4) {
+		return false;
+	}
+	return parse_int(F[1], start) and parse_int(F[2], stop) and parse_double(F[3], coverage);
+}
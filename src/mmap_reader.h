@@ -0,0 +1,101 @@
+#ifndef mmap_reader_H
+#define mmap_reader_H
+#include <string>
+#include <cstddef>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <zlib.h>
+using namespace std;
+
+#define TEXT_FILE 0
+#define GZIP_FILE 1
+#define BGZF_FILE 2
+#define TEXT_END ((size_t)-1)
+
+//inflater state at a known offset of the text of a plain gzip file, seeks start
+//from the nearest one before them instead of the top of the file
+class gzip_point{
+public:
+	size_t at;
+	z_stream z;
+};
+
+//read only view of an entire file, mmap()ed when the file allows it and read
+//into memory otherwise (pipes, special files). gzip/BGZF files stay compressed
+//here, their text is read a bounded piece at a time through text_reader
+class mapped_file{
+public:
+	const char * data;
+	size_t size;
+	bool mapped;
+	int format;
+	vector<size_t> member_in, member_out;  //BGZF: compressed and inflated offset of every member
+	vector<gzip_point *> points;           //plain gzip: points[k] is at (k + 1) * GZIP_SPAN, or NULL
+	mutex point_lock;
+	atomic<bool> corrupt;                  //a text_reader hit damaged compressed data
+	mapped_file();
+	~mapped_file();
+	bool open(string);
+	void close();
+};
+
+//hands out the text [begin, end) of a mapped_file in pieces ending on a line
+//break: plain files in one piece straight from the mapping, compressed ones
+//inflated into a buffer of about TEXT_PIECE bytes (more only for longer lines).
+//A reader kept open moves forward through the file without inflating anything twice
+class text_reader{
+public:
+	text_reader();
+	text_reader(mapped_file *);
+	~text_reader();
+	void open(mapped_file *, size_t, size_t);
+	bool next(const char *&, const char *&);
+	size_t tell();
+private:
+	mapped_file * MF;
+	size_t at, end;
+	vector<char> buf;       //inflated text [w0, w1)
+	size_t w0, w1;
+	bool eof, started;
+	int member;             //BGZF: the next member to inflate
+	z_stream z;             //plain gzip: output so far ends at w1
+	bool z_open;
+	text_reader(const text_reader &);
+	void seek();
+	bool fill();
+};
+
+//a field of a line, points into the mapped file (no copy)
+class text_field{
+public:
+	const char * s;
+	int n;
+	string str();
+	bool equals(const string &);
+};
+
+//walks the lines of a buffer and splits them into fields without allocating; with
+//a text_reader the buffer is refilled from it, the current line stays valid until next()
+class line_scanner{
+public:
+	const char * p, * end;
+	const char * line, * line_end; //current line, newline (and \r) stripped
+	text_reader * source;
+	line_scanner();
+	line_scanner(const char *, const char *);
+	line_scanner(text_reader *);
+	bool next();
+	int split(char, text_field *, int);
+	string str();
+	size_t offset();
+private:
+	const char * piece;
+	size_t piece_at;
+};
+
+bool parse_int(text_field, int &);
+bool parse_double(text_field, double &);
+bool parse_bedgraph(line_scanner &, text_field *, int &, int &, double &);
+
+#endif
@@ -9,6 +9,7 @@
 #include <unistd.h>
 #include <random>
 #include "omp.h"
+#include "simd_math.h"
 
 //=============================================
 //Helper functions
@@ -65,6 +66,14 @@ double NOISE::pdf(double x, int strand) {
 	return (w * (1 - pi)) / abs(b - a);
 }
 
+//the batch entry points give out[i] = pdf(x[i], strand) for n points
+void NOISE::pdf_batch(const double * x, int n, int strand, double * out) {
+	double p 	= pdf(0, strand);
+	for (int i = 0; i < n; i++) {
+		out[i] 	= p;
+	}
+}
+
 
 //=============================================
 //Uniform Class
@@ -106,6 +115,17 @@ double UNI::pdf(double x, int strand) {
 	return 0;
 }
 
+void UNI::pdf_batch(const double * x, int n, int strand, double * out) {
+	double p 	= 0;
+	if (w != 0) {
+		p 	= w / abs(b - a);
+		p 	= p * pow(pi, max(0, strand) ) * pow(1. - pi, max(0, -strand) );
+	}
+	for (int i = 0; i < n; i++) {
+		out[i] 	= (a <= x[i] and x[i] <= b) ? p : 0;
+	}
+}
+
 string UNI::print() {
 	string text = ("U: " + to_string(a) + "," + to_string(b)
 	               + "," + to_string(w) + "," + to_string(pi));
@@ -158,6 +178,30 @@ double EMG::pdf(double z, int s ) {
 	}
 	return 0.0;
 }
+//exp and erfc of all points go through simd_math in one call each; work holds
+//n doubles the caller owns
+void EMG::pdf_batch(const double * x, int n, int s, double * out, double * work) {
+	if (w == 0) {
+		fill(out, out + n, 0.0);
+		return;
+	}
+	double * vl = out, * C = work;
+	double ls2 	= l * pow(si, 2), rs2 = sqrt(2) * si;
+	for (int i = 0; i < n; i++) {
+		double z 	= x[i] - s * foot_print;
+		vl[i] 		= (l / 2.0) * (s * 2 * (mu - z) + ls2);
+		C[i] 		= (s * (mu - z) + ls2 ) / rs2;
+	}
+	exp_batch(vl, n, vl);
+	erfc_batch(C, n, C);
+	double W 	= pow(pi, max(0, s) ), W2 = pow(1 - pi, max(0, -s) ), P_MAX = pow(10, 7);
+	for (int i = 0; i < n; i++) {
+		double p 	= (l / 2) * vl[i] * C[i];
+		p 			= p * w * W * W2;
+		out[i] 		= (p < P_MAX and not isnan(float(p)) ) ? p : 0.0;
+	}
+}
+
 //conditional expectation of Y given z_i
 double EMG::EY(double z, int s) {
 	if (s == 1) {
@@ -182,15 +226,16 @@ double EMG::EY2(double z, int s) {
 //functions that help estimate uniform support bounds
 int get_nearest_position(segment * data, double center, double dist) {
 	int i;
+	coverage_view X 	= data->view();
 
 	if (dist < 0 ) {
 		i = 0;
-		while (i < (data->XN - 1) and (data->X[0][i] - center) < dist) {
+		while (i < (data->XN - 1) and (X.x(i) - center) < dist) {
 			i++;
 		}
 	} else {
 		i = data->XN - 1;
-		while (i > 0 and (data->X[0][i] - center) > dist) {
+		while (i > 0 and (X.x(i) - center) > dist) {
 			i--;
 		}
 	}
@@ -199,8 +244,9 @@ int get_nearest_position(segment * data, double center, double dist) {
 
 double get_sum(segment * data, int j, int k, int st) {
 	double S 	= 0;
+	const float * Y 	= (st == 1) ? data->X.fwd : data->X.rev;
 	for (int i = j; i < k; i++) {
-		S += data->X[st][i];
+		S += Y[i];
 	}
 	return S;
 }
@@ -260,6 +306,7 @@ void update_j_k( component * components, segment * data, int K, double N) {
 }
 
 void update_l(component * components, segment * data, int K) {
+	coverage_view X 	= data->view();
 	for (int k 	= 0; k < K; k++) {
 		//forward
 		double left_SUM = 0, right_SUM = get_sum(data, components[k].forward.j , components[k].forward.k, 1);
@@ -274,9 +321,9 @@ void update_l(component * components, segment * data, int K) {
 		int arg_l 	= components[k].forward.k;
 
 		for (int l = components[k].forward.j; l < components[k].forward.k; l++ ) {
-			left_SUM += data->X[1][l];
-			right_SUM -= data->X[1][l];
-			vl 		= 1.0 / (data->X[0][l] - data->X[0][components[k].forward.j]);
+			left_SUM += X.fwd[l];
+			right_SUM -= X.fwd[l];
+			vl 		= 1.0 / (X.x(l) - X.x(components[k].forward.j));
 			w 		= left_SUM / (N);
 			mod_ll 	= LOG(w * vl) * left_SUM + LOG(null_vl) * right_SUM ;
 			mod_BIC = -2 * mod_ll + 5 * LOG(N);
@@ -289,7 +336,7 @@ void update_l(component * components, segment * data, int K) {
 			prev_prev = prev;
 			prev 	= current;
 		}
-		components[k].forward.b 	= data->X[0][arg_l];
+		components[k].forward.b 	= X.x(arg_l);
 		//reverse
 		arg_l 	= components[k].reverse.j;
 		left_SUM = 0, right_SUM = get_sum(data, components[k].reverse.j, components[k].reverse.k, 2 );
@@ -298,9 +345,9 @@ void update_l(component * components, segment * data, int K) {
 		null_BIC = -2 * null_ll + LOG(N);
 		prev_prev = 0, prev = 0, current = 0, BIC_best = 0;
 		for (int l = components[k].reverse.j; l < components[k].reverse.k; l++ ) {
-			left_SUM += data->X[2][l];
-			right_SUM -= data->X[2][l];
-			vl 		= 1.0 / (data->X[0][components[k].reverse.k] - data->X[0][l]);
+			left_SUM += X.rev[l];
+			right_SUM -= X.rev[l];
+			vl 		= 1.0 / (X.x(components[k].reverse.k) - X.x(l));
 			w 		= right_SUM / (N);
 			mod_ll 	= LOG(null_vl) * left_SUM + LOG(w * vl) * right_SUM ;
 			mod_BIC = -2 * mod_ll + 5 * LOG(N);
@@ -313,7 +360,7 @@ void update_l(component * components, segment * data, int K) {
 			prev_prev = prev;
 			prev 	= current;
 		}
-		components[k].reverse.a 	= data->X[0][arg_l];
+		components[k].reverse.a 	= X.x(arg_l);
 	}
 }
 
@@ -442,6 +489,46 @@ double component::evaluate(double x, int st) {
 	forward.ri_reverse 	= forward.pdf(x, st);
 	return bidir.ri_reverse + reverse.ri_reverse + forward.ri_reverse;
 }
+//evaluate() for every point with data at once: xf (nf points) on the forward and
+//xr (nr) on the reverse strand, D gets [bidir | forward | reverse] of each
+//strand (3 * nf then 3 * nr values), the noise component only fills the first
+//block of each
+void component::evaluate_batch(const double * xf, int nf, const double * xr, int nr, double * D, double * work) {
+	if (type == 0) {
+		noise.pdf_batch(xf, nf, 1, D);
+		noise.pdf_batch(xr, nr, -1, D + 3 * nf);
+		return;
+	}
+	bidir.pdf_batch(xf, nf, 1, D, work);
+	forward.pdf_batch(xf, nf, 1, D + nf);
+	reverse.pdf_batch(xf, nf, 1, D + 2 * nf);
+	bidir.pdf_batch(xr, nr, -1, D + 3 * nf, work);
+	forward.pdf_batch(xr, nr, -1, D + 3 * nf + nr);
+	reverse.pdf_batch(xr, nr, -1, D + 3 * nf + 2 * nr);
+}
+
+//what evaluate() returns (and leaves for add_stats) at point c of a strand,
+//read from evaluate_batch
+double component::evaluated(const double * D, int nf, int nr, int c, int st) {
+	if (st == 1) {
+		if (type == 0) {
+			return D[c];
+		}
+		bidir.ri_forward 	= D[c];
+		forward.ri_forward 	= D[nf + c];
+		reverse.ri_forward 	= D[2 * nf + c];
+		return bidir.ri_forward + forward.ri_forward + reverse.ri_forward;
+	}
+	const double * R 	= D + 3 * nf;
+	if (type == 0) {
+		return R[c];
+	}
+	bidir.ri_reverse 	= R[c];
+	reverse.ri_reverse 	= R[2 * nr + c];
+	forward.ri_reverse 	= R[nr + c];
+	return bidir.ri_reverse + reverse.ri_reverse + forward.ri_reverse;
+}
+
 //compute the conditional expectations and add to running total
 void component::add_stats(double x, double y, int st, double normalize) {
 	if (type == 0) { //noise component
@@ -669,6 +756,7 @@ classifier::classifier() {};
 //this IS the EM...estimate away
 int classifier::fit2(segment * data, vector<double> mu_seeds, int topology,
                      int elon_move ) {
+	coverage_view X 	= data->view();
 	//=========================================================================
 	//compute just a uniform model...no need for the EM
 	if (K == 0) {
@@ -677,16 +765,16 @@ int classifier::fit2(segment * data, vector<double> mu_seeds, int topology,
 		double pos 	= 0;
 		double neg 	= 0;
 		for (int i = 0; i < data->XN; i++) {
-			pos += data->X[1][i];
-			neg += data->X[2][i];
+			pos += X.fwd[i];
+			neg += X.rev[i];
 		}
 		double pi 	= pos / (pos + neg);
 		for (int i = 0; i < data->XN; i++) {
 			if (pi > 0) {
-				ll += log(pi / l) * data->X[1][i];
+				ll += log(pi / l) * X.fwd[i];
 			}
 			if (pi < 1) {
-				ll += log((1 - pi) / l) * data->X[2][i];
+				ll += log((1 - pi) / l) * X.rev[i];
 			}
 		}
 		components 	= new component[1];
@@ -755,6 +843,19 @@ int classifier::fit2(segment * data, vector<double> mu_seeds, int topology,
 	converged 		= false; //has the EM converged?
 	int u 			= 0; //elongation movement ticker
 	double norm_forward, norm_reverse, N; //helper variables
+	//positions with data on each strand, the densities of all components there
+	//are computed in one batch per component and strand
+	xf.clear(), xr.clear();
+	for (int i = 0; i < data->XN; i++) {
+		if (X.fwd[i]) {
+			xf.push_back(X.x(i));
+		}
+		if (X.rev[i]) {
+			xr.push_back(X.x(i));
+		}
+	}
+	int nf = xf.size(), nr = xr.size();
+	D.resize((K + add) * 3 * (nf + nr)), work.resize(max(nf, nr));
 
 	while (t < max_iterations && not converged) {
 		//======================================================
@@ -772,32 +873,37 @@ int classifier::fit2(segment * data, vector<double> mu_seeds, int topology,
 		//======================================================
 		//E-step, grab all the stats and responsibilities
 		ll 	= 0;
+		for (int k = 0; k < K + add; k++) {
+			components[k].evaluate_batch(xf.data(), nf, xr.data(), nr, &D[k * 3 * (nf + nr)], work.data());
+		}
+		int cf = 0, cr = 0;
 		for (int i = 0; i < data->XN; i++) {
 			norm_forward = 0;
 			norm_reverse = 0;
 
 			for (int k = 0; k < K + add; k++) { //computing the responsibility terms
-				if (data->X[1][i]) { //if there is actually data point here...
-					norm_forward += components[k].evaluate(data->X[0][i], 1);
+				if (X.fwd[i]) { //if there is actually data point here...
+					norm_forward += components[k].evaluated(&D[k * 3 * (nf + nr)], nf, nr, cf, 1);
 				}
-				if (data->X[2][i]) { //if there is actually data point here...
-					norm_reverse += components[k].evaluate(data->X[0][i], -1);
+				if (X.rev[i]) { //if there is actually data point here...
+					norm_reverse += components[k].evaluated(&D[k * 3 * (nf + nr)], nf, nr, cr, -1);
 				}
 			}
+			cf += (X.fwd[i] != 0), cr += (X.rev[i] != 0);
 			if (norm_forward > 0) {
-				ll += LOG(norm_forward) * data->X[1][i];
+				ll += LOG(norm_forward) * X.fwd[i];
 			}
 			if (norm_reverse > 0) {
-				ll += LOG(norm_reverse) * data->X[2][i];
+				ll += LOG(norm_reverse) * X.rev[i];
 			}
 
 			//now we need to add the sufficient statistics, need to compute expectations
 			for (int k = 0; k < K + add; k++) {
 				if (norm_forward) {
-					components[k].add_stats(data->X[0][i], data->X[1][i], 1, norm_forward);
+					components[k].add_stats(X.x(i), X.fwd[i], 1, norm_forward);
 				}
 				if (norm_reverse) {
-					components[k].add_stats(data->X[0][i], data->X[2][i], -1, norm_reverse);
+					components[k].add_stats(X.x(i), X.rev[i], -1, norm_reverse);
 				}
 			}
 		}
@@ -17,6 +17,7 @@ public:
 	UNI();
 	UNI(double, double, double, int, int, double);
 	double pdf(double,int);	
+	void pdf_batch(const double *, int, int, double *);
 	string print();
 
 };
@@ -38,6 +39,7 @@ public:
 	EMG();
 	EMG(double, double, double, double, double);
 	double pdf(double,int);
+	void pdf_batch(const double *, int, int, double *, double *);
 	double EY(double ,int);
 	double EY2(double ,int);
 	string print();
@@ -59,6 +61,7 @@ public:
 	double ri_forward, ri_reverse; //current responsibility
 	double r_forward, r_reverse; //running total
 	double pdf(double, int);
+	void pdf_batch(const double *, int, int, double *);
 	NOISE();
 	NOISE(double, double, double, double);
 };
@@ -102,6 +105,8 @@ public:
 	void initialize_with_parameters2(vector<double>, segment *, int, double, double, double);
 	void initialize_bounds(double,  segment *, int , double , double, double, double, double, double);
 	double evaluate(double, int);
+	void evaluate_batch(const double *, int, const double *, int, double *, double *);
+	double evaluated(const double *, int, int, int, int);
 	void add_stats(double, double , int, double);
 	double pdf(double , int);
 	void update_parameters(double,int);
@@ -152,6 +157,7 @@ public:
 	bool move_l;
 	double ALPHA_0, BETA_0, ALPHA_1, BETA_1, ALPHA_2, ALPHA_3;
 	vector<vector<double>> init_parameters;
+	vector<double> xf, xr, D, work; //E-step of fit2, kept between fits
 };
 
 
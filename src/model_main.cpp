@@ -7,17 +7,7 @@ using namespace std;
 int model_run(params * P, int rank, int nprocs, double density, int job_ID, Log_File * LG){
 	int verbose 	= stoi(P->p["-v"]);
 	LG->write("\ninitializing model module...............................done\n\n",verbose);
-	int threads 	= omp_get_max_threads();//number of OpenMP threads that are available for use	
-	string job_name = P->p["-N"];
-
-	//=======================================================================================
-	//input file paths
-	string forward_bed_graph_file 	= P->p["-i"];
-	string reverse_bed_graph_file 	= P->p["-j"];
-	string joint_bed_graph_file 	= P->p["-ij"];
 	string interval_file 			= P->p["-k"];
-	string out_file_dir 			= P->p["-o"];
-	string spec_chrom 				= P->p["-chr"];
 	//=======================================================================================
 	//(1a) load intervals and keep track of their associated IDS
 	map<int, string> IDS;
@@ -31,6 +21,20 @@ int model_run(params * P, int rank, int nprocs, double density, int job_ID, Log_
 		return 1;
 	}
 	LG->write("done\n",verbose);
+	return model_run(P, rank, nprocs, density, job_ID, LG, FSI, IDS, vector<segment *>());
+}
+
+//FSI/IDS are only needed on rank 0; when bidir hands over its genome wide bins as
+//coverage the bedgraph files aren't read again
+int model_run(params * P, int rank, int nprocs, double density, int job_ID, Log_File * LG,
+	vector<segment *> FSI, map<int, string> IDS, vector<segment *> coverage){
+	int verbose 	= stoi(P->p["-v"]);
+	//=======================================================================================
+	//input file paths
+	string forward_bed_graph_file 	= P->p["-i"];
+	string reverse_bed_graph_file 	= P->p["-j"];
+	string joint_bed_graph_file 	= P->p["-ij"];
+	string out_file_dir 			= P->p["-o"];
 	//(1b) now broadcast the intervals of interest to individual MPI processes
 	LG->write("sending interval assignments............................",verbose);
 	map<string, vector<segment *> > GG 	= MPI_comm::send_out_single_fit_assignments(FSI, rank, nprocs);
@@ -40,8 +44,14 @@ int model_run(params * P, int rank, int nprocs, double density, int job_ID, Log_
 	//=======================================================================================
 	//(2a) load bedgraph files and insert them into intervals of interest (interval tree...)
 	LG->write("inserting bedgraph data.................................",verbose);
-	vector<segment*> integrated_segments= load::insert_bedgraph_to_segment_joint(GG, 
-		forward_bed_graph_file, reverse_bed_graph_file, joint_bed_graph_file, rank);
+	vector<segment*> integrated_segments;
+	if (coverage.empty()){
+		integrated_segments 	= load::insert_bedgraph_to_segment_joint(GG, 
+			forward_bed_graph_file, reverse_bed_graph_file, joint_bed_graph_file, rank,
+			stoi(P->p["-br"]), stof(P->p["-ns"]));
+	}else{
+		integrated_segments 	= load::insert_binned_segments(GG, coverage, stoi(P->p["-br"]));
+	}
 	//(2b) for each segment we are going to bin and scale and center, numerical stability
 	LG->write("done\n",verbose);
 	LG->write("binning, centering, scaling.............................",verbose);
@@ -56,7 +66,7 @@ int model_run(params * P, int rank, int nprocs, double density, int job_ID, Log_
 	SC.mean = 0.78, SC.std = 0.08; //this dependent on -w 0.9 !!!
 	SC.set_2(stod(P->p["-bct"]));
 	
-	run_global_template_matching(integrated_segments, out_file_dir, P,SC);	
+	run_global_template_matching(integrated_segments, out_file_dir, P,SC,LG);	
 
 	LG->write("done\n",verbose);
 	//=======================================================================================
@@ -2,9 +2,12 @@
 #define model_main_H
 #include "read_in_parameters.h"
 #include "error_stdo_logging.h"
+#include "load.h"
 
 
 int model_run(params *, int, int, double, int, Log_File * );
+int model_run(params *, int, int, double, int, Log_File *, vector<segment *>, map<int, string>,
+	vector<segment *>);
 
 
 #endif 
\ No newline at end of file
@@ -154,7 +154,7 @@ double classifier_single::fit(segment * data,double foot_print){
 		}
 		//e-step
 		for (int i = 0; i < data->XN; i++){
-			x=data->X[0][i],y=data->X[1][i];
+			x=data->X.pos[i],y=data->X.fwd[i];
 			norm 	= 0;
 			for (int k = 0; k < K;k++){
 				norm+=components[k].pdf(x);
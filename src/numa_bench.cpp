@@ -0,0 +1,69 @@
+//numa_bench: read bandwidth of a scan over coverage that was first touched by
+//one thread (what the loader used to leave) against coverage first touched
+//chunk by chunk by the threads that scan it (coverage_block::place)
+//
+//usage: numa_bench [MB per array, default 1024] [none|close|spread, default spread]
+#include "thread_placement.h"
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+using namespace std;
+
+static double scan(const double * pos, const float * fwd, const float * rev, long n, int threads) {
+	double total  = 0;
+	#pragma omp parallel num_threads(threads) reduction(+:total)
+	{
+		int start, stop;
+		scan_chunk(n, threads, omp_get_thread_num(), start, stop);
+		for (int i = start; i < stop; i++) {
+			total += pos[i] * (fwd[i] + rev[i]);
+		}
+	}
+	return total;
+}
+
+static double bandwidth(long n, int threads, bool placed, int rounds) {
+	double * pos  = NULL;
+	float * fwd   = NULL, * rev = NULL;
+	if (posix_memalign((void **)&pos, 64, n * sizeof(double)) or posix_memalign((void **)&fwd, 64, n * sizeof(float))
+	        or posix_memalign((void **)&rev, 64, n * sizeof(float))) {
+		printf("couldn't allocate %ld bins\n", n);
+		exit(1);
+	}
+	#pragma omp parallel num_threads(placed ? threads : 1)
+	{
+		int start, stop;
+		scan_chunk(n, placed ? threads : 1, omp_get_thread_num(), start, stop);
+		for (int i = start; i < stop; i++) {
+			pos[i] = i, fwd[i] = 1, rev[i] = 1;
+		}
+	}
+	double check  = scan(pos, fwd, rev, n, threads);
+	double t      = omp_get_wtime();
+	for (int r = 0; r < rounds; r++) {
+		check += scan(pos, fwd, rev, n, threads);
+	}
+	t   = omp_get_wtime() - t;
+	free(pos), free(fwd), free(rev);
+	if (check < 0) {
+		printf("%g\n", check);
+	}
+	return double(n) * 16 * rounds / t / 1e9;
+}
+
+int main(int argc, char * argv[]) {
+	long MB       = argc > 1 ? atol(argv[1]) : 1024;
+	string mode   = argc > 2 ? argv[2] : "spread";
+	long n        = MB * 1024 * 1024 / sizeof(double);
+	int threads   = omp_get_max_threads();
+	int pinned    = pin_threads(mode);
+	printf("threads           : %d (%d pinned, %s)\n", threads, pinned, mode.c_str());
+	printf("bins              : %ld (%ld MB)\n", n, n * 16 / (1024 * 1024));
+	double one    = bandwidth(n, threads, false, 10);
+	double placed = bandwidth(n, threads, true, 10);
+	printf("first touch by one thread       : %.2f GB/s\n", one);
+	printf("first touch by scanning threads : %.2f GB/s\n", placed);
+	printf("speedup                         : %.2fx\n", placed / one);
+	return 0;
+}
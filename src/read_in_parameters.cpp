@@ -11,6 +11,7 @@
 #include <stdio.h>
 #include <time.h>
 #include <locale>
+#include <cmath>
 #include "split.h"
 #ifdef USING_ICC
 #include <aligned_new>
@@ -50,6 +51,12 @@ params::params(){
   p["-mi"] 		= "2000";
   p["-r_mu"] 		= "0";
   p["-scores"] 	= "";
+  p["-tile"] 		= "0";
+  p["-pyramid"] 	= "0";
+  p["-fft"] 		= "0";
+  p["-mem_budget"] 	= "0";
+  p["-pin"] 		= "none";
+  p["-simd"] 		= "auto";
   //================================================
   //Hyper parameters	
   p["-ALPHA_0"] = "1";
@@ -63,6 +70,7 @@ params::params(){
   p["-lambda"] 		= "2000";
   p["-sigma"] 		= "123";
   p["-foot_print"] 	= "86";
+  p["-fp_res"] 		= "5";
   p["-pi"] 			= "0.5";
   p["-w"] 			= "0.9";
   
@@ -73,6 +81,8 @@ params::params(){
   bidir 			= 0;
   model 			= 0;
   select 			= 0;
+  convert 		= 0;
+  index 			= 0;
   CONFIG 			= 0;
 }
 bool is_decimal(const std::string& s){
@@ -114,7 +124,7 @@ bool is_path(string FILE){
 vector<string> params::validate_parameters(){
 	vector<string> errors;
 	for (int i = 0; i < 17; i++){
-		if (i <8 and not  is_number(p[isIntGroup[i]])  ){
+		if (i <13 and not  is_number(p[isIntGroup[i]])  ){
 			string line = "User provided input for (" + string(isIntGroup[i]) + ") "  ;
 			line+= + "'"+string(p[isIntGroup[i]])+ "'"+ " is not integer valued";
 			errors.push_back(line);
@@ -141,6 +151,20 @@ vector<string> params::validate_parameters(){
 	}else if(not is_path(p["-o"])){
 		errors.push_back("User specified output path, " +  p["-o"] +", but does not exist (-o)" );
 	}
+	if (p["-pin"] != "none" and p["-pin"] != "close" and p["-pin"] != "spread"){
+		errors.push_back("User provided input for (-pin) '" + p["-pin"] + "' is not none, close or spread");
+	}
+	if (p["-simd"] != "auto" and p["-simd"] != "avx512" and p["-simd"] != "avx2" and p["-simd"] != "none"){
+		errors.push_back("User provided input for (-simd) '" + p["-simd"] + "' is not auto, avx512, avx2 or none");
+	}
+	if (is_number(p["-fp_res"]) and stoi(p["-fp_res"]) < 1){
+		errors.push_back("User provided input for (-fp_res) '" + p["-fp_res"] + "' is not at least 1");
+	}
+	//-tile windows are binned on the chromosome's -br grid, so they have to land on it
+	if (is_number(p["-tile"]) and is_number(p["-pad"]) and is_number(p["-br"]) and stoi(p["-tile"]) > 0
+		and (fmod(stod(p["-tile"]), stod(p["-br"])) != 0 or fmod(stod(p["-pad"]), stod(p["-br"])) != 0)){
+		errors.push_back("User provided input for (-tile) '" + p["-tile"] + "' or (-pad) '" + p["-pad"] + "' is not a multiple of -br");
+	}
 	if (!p["-ij"].empty() and (!p["-i"].empty() or !p["-j"].empty() )  ){
 		errors.push_back("User specified both -ij and (-i or -j)");
 	}
@@ -206,6 +230,14 @@ void params::help(){
 	printf("              model selection is performed via penalized bayesian information\n");
 	printf("              criteria. To set the penalty, we consider an ROC curve over signal\n");
 	printf("              with no moment estimate prediction (TN) and bidirectionals found near TSS (TP) \n");
+	printf("convert   : must be provided immediately following the application call \"EMGU\"\n");
+	printf("              bins the bedgraph files (-i/-j or -ij) with -br and -ns and writes\n");
+	printf("              them to {-o}{-N}.tfb; that file may be given as -ij to bidir and\n");
+	printf("              model runs with the same -br and -ns, skipping bedgraph parsing\n");
+	printf("index     : must be provided immediately following the application call \"EMGU\"\n");
+	printf("              writes FILE.tfi next to each bedgraph file (-i/-j or -ij) giving\n");
+	printf("              the byte offsets of every chromosome, runs with -chr then read\n");
+	printf("              only that chromosome (-chr runs also write it on first use)\n");
 	
 	printf("\n\n");
 	header="";
@@ -224,6 +256,7 @@ void params::help(){
 	printf("              chromosome[tab]start[tab]stop[tab]coverage[newline]\n");
 	printf("              coverage < 0 is assumed to correspond to reverse strand\n");
 	printf("              coverage > 0 is assumed to correspond to forward strand\n");
+	printf("-i/-j/-ij : may also be gzip/BGZF compressed bedgraph or bigWig files\n");
 	
 	
 	printf("-k        : /path/to/interval/file\n");
@@ -248,6 +281,11 @@ void params::help(){
 
 
 	printf("-chr      : (chromosome ID; i.e. chr1) specific chromosome to run on (default is \"all\")\n");
+	printf("               bedgraph input is read through FILE.tfi (see index module)\n");
+	printf("-tss      : /path/to/bed/file/of/promoters, the bidir module sets the template\n");
+	printf("              parameters from the average model of these intervals; with -chr all\n");
+	printf("              and no -tile they are cut from the -br bins already loaded, the reads\n");
+	printf("              of a bin counted at its center base\n");
 	printf("-merge    : (boolean integer) will merge overlaping intervals and run model on joint\n");
 	printf("               recommended for bidirectional de novo not recommended for evaluating \n");
 	printf("               gene intervals, default = 0\n");
@@ -256,6 +294,30 @@ void params::help(){
 	printf("              useful only when fitting to FStitch[1] or groHMM[2] output intervals\n");
 	printf("-pad      : (positive integer) each provided interval will be extended\n");
 	printf("              in both the five-prime and three-prime direction (default=1000)\n");
+	printf("-tile     : (positive integer) specific to the bidir module, scan bedgraph input in\n");
+	printf("              windows of this many bases (plus -pad on both sides) so memory\n");
+	printf("              doesn't grow with chromosome length, both multiples of -br,\n");
+	printf("              (default=0, whole chromosomes)\n");
+	printf("-pyramid  : (integer) specific to the bidir module, 1 skips template matching where\n");
+	printf("              block sums of the coverage (64 and 8 bins wide) rule out a hit,\n");
+	printf("              -scores then holds NA there; 2 runs the full scan instead and logs\n");
+	printf("              (-log_out) how many of its hits the pyramid would have skipped,\n");
+	printf("              (default=0)\n");
+	printf("-fft      : (boolean integer) specific to the bidir module, computes the template\n");
+	printf("              likelihood of all window centers at once by FFT convolution instead\n");
+	printf("              of window by window, (default=0)\n");
+	printf("-fp_res   : (positive integer) specific to the bidir module, number of footprint\n");
+	printf("              sizes from 0 up to -foot_print the template is tried with, (default=5)\n");
+	printf("-mem_budget: (positive integer) specific to the bidir module, megabytes of binned\n");
+	printf("              coverage each MPI process keeps in memory, the rest goes to a\n");
+	printf("              scratch file in -o and is paged in when needed, (default=0, no limit)\n");
+	printf("-pin      : (none, close or spread) binds each OpenMP thread to a CPU of the\n");
+	printf("              process (close: consecutive CPUs, spread: evenly over them, i.e. over\n");
+	printf("              all sockets) and places binned coverage on the NUMA node of the\n");
+	printf("              thread that scans it, (default=none)\n");
+	printf("-simd     : (auto, avx512, avx2 or none) vector instructions for the EMG densities,\n");
+	printf("              auto takes the widest the CPU has, none uses the C math library\n");
+	printf("              (reproduces results exactly across machines), (default=auto)\n");
 	printf("-MLE      : (boolean integer) specific to the bidir module, will perform parameter\n");
 	printf("              inference via EM (highly recommended for accuracy)\n");
 	printf("-ms_pen   : (positive floating) penalty term in BIC criteria for model selection\n");
@@ -336,6 +398,12 @@ void params::display(int nodes, int cores){
 	if (select){
 	header+="            ....BIC penalty optimization....                      \n";		
 	}
+	if (convert){
+	header+="            ....binning bedgraph coverage....                     \n";
+	}
+	if (index){
+	header+="            ....indexing bedgraph chromosomes....                 \n";
+	}
 	printf("%s\n",header.c_str() );
 	printf("-N         : %s\n", p["-N"].c_str()  );
 	if (not p["-ij"].empty()){
@@ -360,6 +428,27 @@ void params::display(int nodes, int cores){
 		printf("-elon      : %s\n", p["-elon"].c_str()  );
 	}
 	printf("-pad       : %s\n", p["-pad"].c_str()  );
+	if (stoi(p["-tile"])){
+		printf("-tile      : %s\n", p["-tile"].c_str()  );
+	}
+	if (stoi(p["-pyramid"])){
+		printf("-pyramid   : %s\n", p["-pyramid"].c_str()  );
+	}
+	if (stoi(p["-fp_res"]) != 5){
+		printf("-fp_res    : %s\n", p["-fp_res"].c_str()  );
+	}
+	if (stoi(p["-fft"])){
+		printf("-fft       : %s\n", p["-fft"].c_str()  );
+	}
+	if (stoi(p["-mem_budget"])){
+		printf("-mem_budget: %s\n", p["-mem_budget"].c_str()  );
+	}
+	if (p["-pin"] != "none"){
+		printf("-pin       : %s\n", p["-pin"].c_str()  );
+	}
+	if (p["-simd"] != "auto"){
+		printf("-simd      : %s\n", p["-simd"].c_str()  );
+	}
 	if (!model){
 	printf("-bct       : %s\n", p["-bct"].c_str());
 	}
@@ -395,6 +484,18 @@ string params::get_header(int ID){
 	if (ID==1){
 		header+="#-bct         : "+p["-bct"]+"\n";
 		header+="#-pad         : "+p["-pad"]+"\n";
+		if (stoi(p["-tile"])){
+		header+="#-tile        : "+p["-tile"]+"\n";
+		}
+		if (stoi(p["-pyramid"])){
+		header+="#-pyramid     : "+p["-pyramid"]+"\n";
+		}
+		if (stoi(p["-fft"])){
+		header+="#-fft         : "+p["-fft"]+"\n";
+		}
+		if (stoi(p["-mem_budget"])){
+		header+="#-mem_budget  : "+p["-mem_budget"]+"\n";
+		}
 	}
 	if (ID!=1){
 		header+="#-elon        : "+p["-elon"]+"\n";
@@ -415,6 +516,9 @@ string params::get_header(int ID){
 		header+="#-sigma       : "+ p["-sigma"] +"\n";
 		header+="#-lambda      : "+ p["-lambda"]+"\n";
 		header+="#-foot_print  : "+ p["-foot_print"]+"\n";
+		if (stoi(p["-fp_res"]) != 5){
+		header+="#-fp_res      : "+ p["-fp_res"]+"\n";
+		}
 		header+="#-pi          : "+ p["-pi"]+"\n";
 		header+="#-w           : "+ p["-w"]+"\n";
 	}
@@ -520,7 +624,7 @@ int read_in_parameters( char* argv[], params * P, int rank){
 	argv = ++argv;
 	if (not *argv){
 		if (rank==0){
-			printf("No module found, please specify either bidir, model or select\n");
+			printf("No module found, please specify either bidir, model, select, convert or index\n");
 		}
 		P->EXIT = 1;
 		return 1;
@@ -543,6 +647,12 @@ int read_in_parameters( char* argv[], params * P, int rank){
 		else if(F.size() == 6 and F.substr(0,6)=="select"){
 			P->select 	= 1;
 		}
+		else if(F.size() == 7 and F.substr(0,7)=="convert"){
+			P->convert 	= 1;
+		}
+		else if(F.size() == 5 and F.substr(0,5)=="index"){
+			P->index 	= 1;
+		}
 		else{
 			if (rank == 0){
 				printf("couldn't understand user provided module option: %s\n",F.c_str() );
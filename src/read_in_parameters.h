@@ -22,6 +22,8 @@ public:
 	bool model;
 	bool CONFIG;
 	bool select;
+	bool convert;
+	bool index;
 
 	map<string, string> p2;
 
@@ -30,8 +32,9 @@ public:
 	map<string, string> p5;
 	map<string, string> p6;
 	
-	char * isIntGroup[8] = {"-pad", "-minK", "-maxK", 
-						 "-rounds", "-mi", "-MLE", "-elon", "-merge"};
+	char * isIntGroup[13] = {"-pad", "-minK", "-maxK", 
+						 "-rounds", "-mi", "-MLE", "-elon", "-merge", "-tile", "-pyramid", "-mem_budget", "-fft",
+						 "-fp_res"};
 
 	char * isDecGroup[17]  = {  "-br","-ns", "-ct",
 						"-max_noise",    "-r_mu",
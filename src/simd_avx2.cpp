@@ -0,0 +1,4 @@
+//built with -mavx2
+#define SIMD_W 4
+#define SIMD_NS simd_avx2
+#include "simd_kernels.h"
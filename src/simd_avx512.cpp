@@ -0,0 +1,4 @@
+//built with -mavx512f
+#define SIMD_W 8
+#define SIMD_NS simd_avx512
+#include "simd_kernels.h"
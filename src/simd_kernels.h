@@ -0,0 +1,131 @@
+//vector exp, erfc and log behind simd_math; included by one file per
+//instruction set, which defines SIMD_W (doubles per vector) and SIMD_NS and is
+//built with the matching -m flags. Lanes never branch, special values are
+//selected at the end
+#include <cmath>
+#include <cstring>
+
+namespace SIMD_NS {
+
+typedef double vd __attribute__((vector_size(SIMD_W * 8)));
+typedef long long vl __attribute__((vector_size(SIMD_W * 8)));
+
+static inline vd V(double a) {
+	return vd{} + a;
+}
+
+static inline vl I(long long a) {
+	return vl{} + a;
+}
+
+//1 / i!
+static const double EXP_TAYLOR[14] = {
+	1.0, 1.0, 0.5, 0.16666666666666666, 0.041666666666666664,
+	0.008333333333333333, 0.001388888888888889, 0.0001984126984126984, 2.48015873015873e-05, 2.7557319223985893e-06,
+	2.755731922398589e-07, 2.505210838544172e-08, 2.08767569878681e-09, 1.6059043836821613e-10,
+};
+
+//x = k ln2 + r, |r| <= ln2 / 2, e^r by its Taylor series to r^13; 2^k is
+//applied in two halves so the result can go subnormal
+static inline vd v_exp(vd x) {
+	const double shifter  = 6755399441055744.0;
+	vd xc = x < V(-746) ? V(-746) : x;
+	xc    = xc > V(710) ? V(710) : xc;
+	vd kd = xc * V(1.4426950408889634) + V(shifter);
+	vl k  = (vl)kd - (vl)V(shifter);
+	kd    = kd - V(shifter);
+	vd r  = xc - kd * V(6.93147180369123816490e-01) - kd * V(1.90821492927058770002e-10);
+	vd p  = V(EXP_TAYLOR[13]);
+	for (int i = 12; i >= 0; i--) {
+		p  = p * r + V(EXP_TAYLOR[i]);
+	}
+	vl k1 = k >> 1, k2 = k - k1;
+	vd y  = p * (vd)((k1 + I(1023)) << 52) * (vd)((k2 + I(1023)) << 52);
+	y     = x > V(709.782712893384) ? V(INFINITY) : y;
+	return x != x ? x : y;
+}
+
+//x = 2^e m, sqrt(1/2) <= m < sqrt(2), log m = 2 atanh(f) with f = (m - 1) / (m + 1)
+static inline vd v_log(vd x) {
+	vl tiny = x < V(2.2250738585072014e-308);
+	vd xs   = tiny ? x * V(18014398509481984.0) : x;
+	vl b    = (vl)xs;
+	vl e    = ((b >> 52) & I(0x7ff)) - I(1023) - (tiny ? I(54) : I(0));
+	vd m    = (vd)((b & I(0x000fffffffffffffLL)) | I(0x3ff0000000000000LL));
+	vl big  = m > V(M_SQRT2);
+	m       = big ? m * V(0.5) : m;
+	e       = big ? e + I(1) : e;
+	vd f    = (m - V(1)) / (m + V(1)), s = f * f;
+	vd q    = V(1.0 / 21);
+	for (int i = 9; i >= 0; i--) {
+		q  = q * s + V(1.0 / (2 * i + 1));
+	}
+	vd ed   = __builtin_convertvector(e, vd);
+	vd y    = ed * V(6.93147180369123816490e-01) + (V(2) * f * q + ed * V(1.90821492927058770002e-10));
+	y       = x == V(0) ? V(-INFINITY) : y;
+	y       = x < V(0) ? V(NAN) : y;
+	y       = x == V(INFINITY) ? x : y;
+	return x != x ? x : y;
+}
+
+//erfc(z) = t exp(-z^2 + P(4t - 2)) for z >= 0, t = 2 / (2 + z), P a Chebyshev
+//series (the form of Numerical Recipes' erfccheb, coefficients refit to 1e-17);
+//z^2 is split exactly so its rounding isn't magnified by exp
+static const double ERFC_CHEB[28] = {
+	-1.3026537197817094, 0.6419697923564902, 0.019476473204185836, -0.009561514786808632,
+	-0.0009465953444820369, 0.00036683949785276145, 4.252332480690777e-05, -2.0278578112534242e-05,
+	-1.6242900046470256e-06, 1.3036558355805232e-06, 1.5626441722066142e-08, -8.523809591492654e-08,
+	6.5290544390988515e-09, 5.059343495551469e-09, -9.91364156493033e-10, -2.273651222931836e-10,
+	9.646791102015527e-11, 2.3940380830391146e-12, -6.886027526497553e-12, 8.944879273090725e-13,
+	3.130921399342958e-13, -1.1270822361367252e-13, 3.810905255189232e-16, 7.106097613609237e-15,
+	-1.5230282014571043e-15, -9.457494571291233e-17, 1.210237189224279e-16, -2.816663087747177e-17,
+};
+
+static inline vd v_erfc(vd x) {
+	vd z  = (vd)((vl)x & I(0x7fffffffffffffffLL));
+	z     = z > V(30) ? V(30) : z;
+	vd t  = V(2) / (V(2) + z), ty = V(4) * t - V(2);
+	vd d  = V(0), dd = V(0);
+	for (int j = 27; j > 0; j--) {
+		vd tmp  = d;
+		d       = ty * d - dd + V(ERFC_CHEB[j]);
+		dd      = tmp;
+	}
+	vd P  = V(0.5) * (V(ERFC_CHEB[0]) + ty * d) - dd;
+	vd cz = V(134217729.0) * z, zh = cz - (cz - z), zl = z - zh;
+	vd hi = z * z, lo = ((zh * zh - hi) + V(2) * zh * zl) + zl * zl;
+	vd y  = t * v_exp(-hi) * v_exp(P - lo);
+	y     = x < V(0) ? V(2) - y : y;
+	return x != x ? x : y;
+}
+
+template <vd (*F)(vd)>
+static void apply(const double * x, int n, double * out) {
+	vd v;
+	int i = 0;
+	for (; i + SIMD_W <= n; i += SIMD_W) {
+		memcpy(&v, x + i, sizeof(vd));
+		v  = F(v);
+		memcpy(out + i, &v, sizeof(vd));
+	}
+	if (i < n) {
+		v  = V(1);
+		memcpy(&v, x + i, (n - i) * sizeof(double));
+		v  = F(v);
+		memcpy(out + i, &v, (n - i) * sizeof(double));
+	}
+}
+
+void exp_batch(const double * x, int n, double * out) {
+	apply<v_exp>(x, n, out);
+}
+
+void erfc_batch(const double * x, int n, double * out) {
+	apply<v_erfc>(x, n, out);
+}
+
+void log_batch(const double * x, int n, double * out) {
+	apply<v_log>(x, n, out);
+}
+
+}
@@ -0,0 +1,60 @@
+#include "simd_math.h"
+#include <cmath>
+using namespace std;
+
+namespace simd_avx2 {
+void exp_batch(const double *, int, double *);
+void erfc_batch(const double *, int, double *);
+void log_batch(const double *, int, double *);
+}
+namespace simd_avx512 {
+void exp_batch(const double *, int, double *);
+void erfc_batch(const double *, int, double *);
+void log_batch(const double *, int, double *);
+}
+
+static void exp_libm(const double * x, int n, double * out) {
+	for (int i = 0; i < n; i++) {
+		out[i]  = exp(x[i]);
+	}
+}
+
+static void erfc_libm(const double * x, int n, double * out) {
+	for (int i = 0; i < n; i++) {
+		out[i]  = erfc(x[i]);
+	}
+}
+
+static void log_libm(const double * x, int n, double * out) {
+	for (int i = 0; i < n; i++) {
+		out[i]  = log(x[i]);
+	}
+}
+
+typedef void (*batch_fn)(const double *, int, double *);
+static batch_fn EXP = exp_libm, ERFC = erfc_libm, LOG = log_libm;
+
+void exp_batch(const double * x, int n, double * out) {
+	EXP(x, n, out);
+}
+
+void erfc_batch(const double * x, int n, double * out) {
+	ERFC(x, n, out);
+}
+
+void log_batch(const double * x, int n, double * out) {
+	LOG(x, n, out);
+}
+
+string set_simd(string level) {
+	if ((level == "auto" or level == "avx512") and __builtin_cpu_supports("avx512f")) {
+		EXP = simd_avx512::exp_batch, ERFC = simd_avx512::erfc_batch, LOG = simd_avx512::log_batch;
+		return "avx512";
+	}
+	if (level != "none" and __builtin_cpu_supports("avx2")) {
+		EXP = simd_avx2::exp_batch, ERFC = simd_avx2::erfc_batch, LOG = simd_avx2::log_batch;
+		return "avx2";
+	}
+	EXP = exp_libm, ERFC = erfc_libm, LOG = log_libm;
+	return "none";
+}
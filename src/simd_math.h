@@ -0,0 +1,17 @@
+#ifndef simd_math_H
+#define simd_math_H
+#include <string>
+using namespace std;
+
+//exp, erfc and log of n doubles at once (out may be x). With AVX-512 or AVX2
+//(picked at runtime from cpuid, see set_simd) they run on 8 or 4 lanes and are
+//within a few ulp of libm; the portable fallback is libm itself
+void exp_batch(const double *, int, double *);
+void erfc_batch(const double *, int, double *);
+void log_batch(const double *, int, double *);
+
+//-simd: auto (the widest the CPU has), avx512, avx2 or none (libm); a level the
+//CPU lacks falls back to the next one down, returns the one in use
+string set_simd(string);
+
+#endif
@@ -11,6 +11,9 @@
 #include <cmath>
 #include "BIC.h"
 #include "FDR.h"
+#include "thread_placement.h"
+#include "fft.h"
+#include <thread>
 using namespace std;
 
 double nINF = -exp(1000);
@@ -62,45 +65,55 @@ int sample_centers(vector<double> centers, double p) {
    return i;//required in model.o (ugh...)
 }
 
-void BIC_template(segment * data,  double * BIC_values, double * densities, double * densities_r, double window,
-                  double sigma, double lambda, double foot_print, double pi, double w) {
+//windows without a single read (counted exactly in occupied, the running sums
+//may not come back to exactly 0) are skipped, BIC3 would only give nan there.
+//Bins whose window holds no more than tf forward or tr reverse reads can't pass
+//check_hit, neither can bins that candidate (if given) rules out; they keep their
+//densities but BIC3 isn't evaluated (BIC 0)
+template <bool grid>
+static void BIC_template_kernel(segment * data,  double * BIC_values, double * densities, double * densities_r, double window,
+                                double sigma, double lambda, double foot_print, double pi, double w, int fp_res, double tf, double tr,
+                                const char * candidate) {
    double vl;
+   coverage_view X = data->view();
    int NN        = int(data->XN);
    int threads   = omp_get_max_threads();
-   int counts    = NN / threads;
+   emg_table T(sigma, lambda, foot_print, pi, w, grid ? X.delta / X.scale : 1, window, fp_res);
 
    #pragma omp parallel num_threads(threads)
    {
-      int tid   = omp_get_thread_num();
-      int start   = tid * counts;
-      int stop  = (tid + 1) * (counts);
-      if (tid + 1 == threads) {
-         stop  = NN;
-      }
-      int j = start, k = start;
+      int start, stop;
+      scan_chunk(NN, threads, omp_get_thread_num(), start, stop);
+      int j = start, k = start, occupied = 0;
       double N_pos = 0, N_neg = 0;
-      double total_density;
+      bic3_scratch S;
       for (int i = start; i < stop; i++) {
-         while ((j < data->XN) and ((data->X[0][j] - data->X[0][i]) < -window)) {
-            N_pos -= data->X[1][j];
-            N_neg -= data->X[2][j];
+         double x_i  = grid ? (i * X.delta) / X.scale : X.pos[i];
+         while ((j < data->XN) and (((grid ? (j * X.delta) / X.scale : X.pos[j]) - x_i) < -window)) {
+            N_pos -= X.fwd[j];
+            N_neg -= X.rev[j];
+            occupied -= (X.fwd[j] != 0 or X.rev[j] != 0);
             j++;
          }
-         while ((k < data->XN) and ((data->X[0][k] - data->X[0][i]) < window)) {
-            N_pos += data->X[1][k];
-            N_neg += data->X[2][k];
+         while ((k < data->XN) and (((grid ? (k * X.delta) / X.scale : X.pos[k]) - x_i) < window)) {
+            N_pos += X.fwd[k];
+            N_neg += X.rev[k];
+            occupied += (X.fwd[k] != 0 or X.rev[k] != 0);
             k++;
          }
 
-         if (k < data->XN  and j < data->XN and k != j ) {
-            total_density   = (N_pos / (data->X[0][k] - data->X[0][j])) + (N_neg / (data->X[0][k] - data->X[0][j]));
+         if (k < data->XN  and j < data->XN and k != j and occupied > 0) {
             densities[i]    = N_pos ;
             densities_r[i]  = N_neg ;
 
-            double mu   = (data->X[0][k] + data->X[0][j]) / 2.;
-
-            BIC_values[i]   = BIC3(data->X,  j,  k,  i, N_pos,  N_neg,
-                                   sigma, lambda, foot_print, pi, w);
+            if (not (N_pos > tf and N_neg > tr) or (candidate != NULL and not candidate[i])) {
+               BIC_values[i]   = 0;
+            } else if (grid) {
+               BIC_values[i]   = BIC3_tabulated(T, X,  j,  k,  i, N_pos,  N_neg, S);
+            } else {
+               BIC_values[i]   = BIC3_kernel<false>(X,  j,  k,  i, N_pos,  N_neg,
+                                                    sigma, lambda, foot_print, pi, w, fp_res, S);
+            }
          } else {
             BIC_values[i]   = 0;
             densities[i]  = 0;
@@ -110,6 +123,150 @@ void BIC_template(segment * data,  double * BIC_values, double * densities, doub
    }
 }
 
+//-fft: on an implicit grid the EMG term of BIC3 is, for every center with the
+//usual window [i - a, i + b), a correlation of fwd and rev with the emg_table
+//columns; blocks of B centers get it from one forward and three inverse FFTs of
+//size M (overlap-save, fwd and rev packed as real and imaginary part, two
+//footprint steps per inverse). Centers with any other window (the segment ends)
+//go through BIC3_tabulated. Skipping follows BIC_template_kernel, and a block
+//with no center left that takes the usual window needs no FFT at all. Unlike
+//BIC_template_kernel a window isn't cut at the first bin of a thread's chunk
+static void BIC_template_fft(segment * data,  double * BIC_values, double * densities, double * densities_r, double window,
+                             double sigma, double lambda, double foot_print, double pi, double w, int fp_res, double tf, double tr,
+                             const char * candidate) {
+   coverage_view X = data->view();
+   int NN        = int(data->XN);
+   int threads   = omp_get_max_threads();
+   emg_table T(sigma, lambda, foot_print, pi, w, X.delta / X.scale, window, fp_res);
+
+   //the usual window, taken at the middle bin
+   int m = NN / 2, a = 0, b = 0;
+   while (m - a > 0 and X.x(m - a - 1) - X.x(m) >= -window) {
+      a++;
+   }
+   while (m + b < NN and X.x(m + b) - X.x(m) < window) {
+      b++;
+   }
+   int L       = a + b;
+   bool finite = (L > 0 and a <= T.W and b <= T.W);
+   for (int o = 0; finite and o < T.F.size(); o++) {
+      finite  = std::isfinite(T.F[o]) and std::isfinite(T.R[o]);
+   }
+   if (not finite) {
+      BIC_template_kernel<true>(data, BIC_values, densities, densities_r, window, sigma, lambda, foot_print, pi, w, fp_res, tf, tr, candidate);
+      return;
+   }
+   int M       = fft_size(max(4 * L, 256));
+   int B       = M - L + 1;
+   fft_plan FP(M);
+   //spectra of the reversed kernels, G[(2 * rs + strand) * M + q]
+   vector<complex<double>> G(2 * T.res * M);
+   for (int rs = 0; rs < T.res; rs++) {
+      complex<double> * GF  = &G[(2 * rs) * M], * GR = &G[(2 * rs + 1) * M];
+      for (int q = 0; q < L; q++) {
+         GF[L - 1 - q]   = T.F[rs * (2 * T.W + 1) + q - a + T.W];
+         GR[L - 1 - q]   = T.R[rs * (2 * T.W + 1) + q - a + T.W];
+      }
+      FP.run(GF, false), FP.run(GR, false);
+   }
+
+   #pragma omp parallel num_threads(threads)
+   {
+      int start, stop;
+      scan_chunk(NN, threads, omp_get_thread_num(), start, stop);
+      vector<complex<double>> U(M), UF(M), UR(M), Y(M);
+      vector<double> C(T.res * B);
+      vector<int> J(B), K(B);
+      vector<char> how(B); //0 no BIC3, 1 from C, 2 BIC3_tabulated
+      bic3_scratch S;
+      int j = max(0, start - T.W - 1), occupied = 0;
+      while (j < NN and start < NN and X.x(j) - X.x(start) < -window) {
+         j++;
+      }
+      int k = j;
+      double N_pos = 0, N_neg = 0;
+      for (int s = start; s < stop; s += B) {
+         int e = min(s + B, stop);
+         bool any  = false;
+         for (int i = s; i < e; i++) {
+            double x_i  = X.x(i);
+            while ((j < NN) and ((X.x(j) - x_i) < -window)) {
+               N_pos -= X.fwd[j];
+               N_neg -= X.rev[j];
+               occupied -= (X.fwd[j] != 0 or X.rev[j] != 0);
+               j++;
+            }
+            while ((k < NN) and ((X.x(k) - x_i) < window)) {
+               N_pos += X.fwd[k];
+               N_neg += X.rev[k];
+               occupied += (X.fwd[k] != 0 or X.rev[k] != 0);
+               k++;
+            }
+            J[i - s] = j, K[i - s] = k, how[i - s] = 0;
+            BIC_values[i]   = 0;
+            if (k < NN and j < NN and k != j and occupied > 0) {
+               densities[i]    = N_pos ;
+               densities_r[i]  = N_neg ;
+               if (N_pos > tf and N_neg > tr and (candidate == NULL or candidate[i])) {
+                  how[i - s]  = (i - j == a and k - i == b) ? 1 : 2;
+                  any         = any or how[i - s] == 1;
+               }
+            } else {
+               densities[i]  = 0;
+               densities_r[i]  = 0;
+            }
+         }
+         if (any) {
+            for (int t = 0; t < M; t++) {
+               int u = s - a + t;
+               U[t]  = (u >= 0 and u < NN) ? complex<double>(X.fwd[u], X.rev[u]) : 0;
+            }
+            FP.run(U.data(), false);
+            for (int q = 0; q < M; q++) {
+               complex<double> Z = U[q], Zc = conj(U[(M - q) & (M - 1)]);
+               UF[q] = (Z + Zc) * 0.5, UR[q] = (Z - Zc) * complex<double>(0, -0.5);
+            }
+            for (int rs = 0; rs < T.res; rs += 2) {
+               const complex<double> * G0 = &G[(2 * rs) * M];
+               const complex<double> * G1 = rs + 1 < T.res ? &G[(2 * rs + 2) * M] : NULL;
+               for (int q = 0; q < M; q++) {
+                  Y[q] = UF[q] * G0[q] + UR[q] * G0[M + q];
+                  if (G1 != NULL) {
+                     Y[q] += complex<double>(0, 1) * (UF[q] * G1[q] + UR[q] * G1[M + q]);
+                  }
+               }
+               FP.run(Y.data(), true);
+               for (int c = 0; c < e - s; c++) {
+                  C[rs * B + c]   = Y[c + L - 1].real() / M;
+                  if (G1 != NULL) {
+                     C[(rs + 1) * B + c] = Y[c + L - 1].imag() / M;
+                  }
+               }
+            }
+         }
+         for (int i = s; i < e; i++) {
+            if (how[i - s] == 1) {
+               BIC_values[i]   = BIC3_correlated(T, X, J[i - s], K[i - s], &C[i - s], B, densities[i], densities_r[i]);
+            } else if (how[i - s] == 2) {
+               BIC_values[i]   = BIC3_tabulated(T, X, J[i - s], K[i - s], i, densities[i], densities_r[i], S);
+            }
+         }
+      }
+   }
+}
+
+void BIC_template(segment * data,  double * BIC_values, double * densities, double * densities_r, double window,
+                  double sigma, double lambda, double foot_print, double pi, double w, int fp_res, double tf, double tr,
+                  const char * candidate, bool fft) {
+   if (data->X.pos == NULL and fft) {
+      BIC_template_fft(data, BIC_values, densities, densities_r, window, sigma, lambda, foot_print, pi, w, fp_res, tf, tr, candidate);
+   } else if (data->X.pos == NULL) {
+      BIC_template_kernel<true>(data, BIC_values, densities, densities_r, window, sigma, lambda, foot_print, pi, w, fp_res, tf, tr, candidate);
+   } else {
+      BIC_template_kernel<false>(data, BIC_values, densities, densities_r, window, sigma, lambda, foot_print, pi, w, fp_res, tf, tr, candidate);
+   }
+}
+
 bool check_hit(double a, double b, double c, double x, double y, double z) {
    if (a > x and b > y and c > z) {
       return true;
@@ -117,18 +274,148 @@ bool check_hit(double a, double b, double c, double x, double y, double z) {
    return false;
 }
 
-double run_global_template_matching(vector<segment*> segments,
-                                    string out_dir,  params * P, slice_ratio SC) {
+//first bin at or right of v, lower_bound over either layout
+static int lower_index(coverage_view X, double v) {
+   int lo  = 0, hi = X.n;
+   while (lo < hi) {
+      int mid   = (lo + hi) / 2;
+      if (X.x(mid) < v) {
+         lo  = mid + 1;
+      } else {
+         hi  = mid;
+      }
+   }
+   return lo;
+}
+
+//true if some bin in [a, b) could have more than tf / tr reads in its window on
+//the forward / reverse strand, going by the blocks of level l. The window of a
+//bin only reaches bins within +-window (BIC_template), one more bin on each side
+//absorbs rounding, and a little slack the order the sums were taken in
+static bool pyramid_pass(const coverage_pyramid & PY, coverage_view X, int l, int a, int b,
+                         double window, double tf, double tr) {
+   int lo  = lower_index(X, X.x(a) - window) - 1;
+   int hi  = lower_index(X, X.x(b - 1) + window) + 1;
+   lo  = max(lo, 0), hi = min(hi, X.n);
+   double F  = PY.sum(l, 0, lo, hi), R = PY.sum(l, 1, lo, hi);
+   return F * (1 + 1e-9) + 1e-9 > tf and R * (1 + 1e-9) + 1e-9 > tr;
+}
+
+static void pyramid_mark(const coverage_pyramid & PY, coverage_view X, int l, int a, int b,
+                         double window, double tf, double tr, char * candidate) {
+   for (int s = a; s < b; s += PY.width[l]) {
+      int e   = min(s + PY.width[l], b);
+      if (not pyramid_pass(PY, X, l, s, e, window, tf, tr)) {
+         continue;
+      }
+      if (l + 1 < PY.width.size()) {
+         pyramid_mark(PY, X, l + 1, s, e, window, tf, tr, candidate);
+      } else {
+         fill(candidate + s, candidate + e, 1);
+      }
+   }
+}
+
+//-pyramid: a bin is a hit only if its window holds more than tf and tr reads
+//(check_hit), so stretches whose 64 and then 8 bin block sums can't get there
+//need no BIC3
+static void pyramid_candidates(segment * data, double window, double tf, double tr, char * candidate) {
+   coverage_view X   = data->view();
+   coverage_pyramid PY(X, {64, 8});
+   fill(candidate, candidate + X.n, 0);
+   pyramid_mark(PY, X, 0, 0, X.n, window, tf, tr, candidate);
+}
+
+//raw hits of one segment (not yet merge()d), tested against the coverage of
+//background (data itself unless data is a window of it); bins starting outside
+//[lo, hi) (genome coordinates) are only context and aren't written to -scores
+vector<vector<double>> template_hits(segment * data, segment * background, params * P, slice_ratio SC,
+                                     ofstream & FHW_scores, bool SCORES, double lo, double hi, Log_File * LG) {
 
    double CTT                    = 5; //filters for low coverage regions
 
    double ns                     = stod(P->p["-ns"]);
    double window                 = stod(P->p["-pad"]) / ns;
    double sigma, lambda, foot_print, pi, w;
-   double ct                     = stod(P->p["-bct"]);
    sigma   = stod(P->p["-sigma"]) / ns , lambda = ns / stod(P->p["-lambda"]);
    foot_print = stod(P->p["-foot_print"]) / ns , pi = stod(P->p["-pi"]), w = stod(P->p["-w"]);
+   int fp_res = stoi(P->p["-fp_res"]);
 
+   if (P->p["-pin"] != "none") {
+      data->X.place();
+   }
+   double * BIC_values   = new double[int(data->XN)];
+   double * densities    = new double[int(data->XN)];
+   double * densities_r  = new double[int(data->XN)];
+
+   double l    =  background->maxX - background->minX;
+   double ef     = background->fN * ( 2 * (window * ns) * 0.05  / (l * ns ));
+   double er     = background->rN * ( 2 * (window * ns) * 0.05 / (l * ns ));
+   double stdf   = sqrt(ef * (1 - (  2 * (window * ns) * 0.05 / (l * ns )  ) )  );
+   double stdr   = sqrt(er * (1 - (  2 * (window * ns) * 0.05 / (l * ns ) ) )  );
+   double tf     = ef + CTT * stdf, tr = er + CTT * stdr; //coverage a hit needs (check_hit)
+   int pyramid       = stoi(P->p["-pyramid"]);
+   char * candidate  = NULL;
+   if (pyramid and data->XN > 0) {
+      candidate   = new char[int(data->XN)];
+      pyramid_candidates(data, window, tf, tr, candidate);
+   }
+   bool fft          = stoi(P->p["-fft"]);
+   //-pyramid 2 scans everything and only counts the hits the pyramid would have
+   //skipped (BIC3 is the same wherever candidate lets it run)
+   BIC_template(data,  BIC_values, densities, densities_r, window, sigma, lambda, foot_print, pi, w, fp_res, tf, tr,
+                pyramid == 2 ? NULL : candidate, fft);
+   if (pyramid == 2 and candidate != NULL) {
+      int differ  = 0;
+      for (int j = 1; j < data->XN - 1; j++) {
+         differ  += (not candidate[j] and check_hit(BIC_values[j], densities[j], densities_r[j], SC.threshold, tf, tr));
+      }
+      if (differ) {
+         LG->write("\n-pyramid 2: " + to_string(differ) + " bins of " + data->chrom + ":" + to_string(data->start) + "-"
+                   + to_string(data->stop) + " differ from the full scan\n", 0);
+      }
+   }
+   delete [] candidate;
+   coverage_view V = data->view();
+   double start = -1, rN = 0.0 , rF = 0.0, rR = 0.0, rB = 0.0;
+   vector<vector<double>> HITS;
+   for (int j = 1; j < data->XN - 1; j++) {
+      bool HIT = check_hit(BIC_values[j], densities[j], 
+         densities_r[j], SC.threshold, tf, tr  );
+      double x  = V.x(j - 1) * ns + data->start;
+      if (SCORES and x >= lo and x < hi) {
+         double vl   = BIC_values[j];
+         if (std::isnan(double(vl)) or std::isinf(double(vl))) {
+            vl    = 0;
+         }
+         //BIC3 wasn't evaluated where the coverage already rules out a hit
+         string BIC  = (densities[j] > tf and densities_r[j] > tr) ? to_string(vl) : "NA";
+         int DENS    = densities[j] + densities_r[j] ;
+         FHW_scores << data->chrom << "\t" << to_string(int(V.x(j - 1)*ns + data->start)) << "\t";
+         FHW_scores << to_string(int(V.x(j)*ns + data->start )) << "\t" << BIC + "\t" + to_string(densities[j]) + "\t" + to_string(densities_r[j]) + "\t" +  to_string(int(HIT)) << endl;
+      }
+      if ( HIT ) {
+         if (start < 0) {
+            start = V.x(j - 1) * ns + data->start;
+         }
+         start += 1, rN += 1 , rF += densities[j], rR += densities_r[j], rB += log10( SC.pvalue(BIC_values[j]) + pow(10, -20)) ;
+      }
+      if (not HIT and start > 0 ) {
+         vector<double> row = {start , V.x(j - 1)*ns + data->start, rB / rN , rF / rN, rR / rN  };
+         HITS.push_back(row);
+         start = -1, rN = 0.0 , rF = 0.0, rR = 0.0, rB = 0.0;
+      }
+   }
+   delete [] BIC_values;
+   delete [] densities;
+   delete [] densities_r;
+   return HITS;
+}
+
+double run_global_template_matching(vector<segment*> segments,
+                                    string out_dir,  params * P, slice_ratio SC, Log_File * LG) {
+   double ns                     = stod(P->p["-ns"]);
+   double window                 = stod(P->p["-pad"]) / ns;
    bool SCORES     = not P->p["-scores"].empty();
 
    ofstream FHW_scores;
@@ -136,48 +423,8 @@ double run_global_template_matching(vector<segment*> segments,
    if (SCORES) {
       FHW_scores.open(P->p["-scores"]);
    }
-   string annotation;
-   int prev, prev_start, stop;
-   int N;
-   int start, center;
-
    for (int i = 0; i < segments.size(); i++) {
-      double * BIC_values   = new double[int(segments[i]->XN)];
-      double * densities    = new double[int(segments[i]->XN)];
-      double * densities_r  = new double[int(segments[i]->XN)];
-
-      double l    =  segments[i]->maxX - segments[i]->minX;
-      double ef     = segments[i]->fN * ( 2 * (window * ns) * 0.05  / (l * ns ));
-      double er     = segments[i]->rN * ( 2 * (window * ns) * 0.05 / (l * ns ));
-      double stdf   = sqrt(ef * (1 - (  2 * (window * ns) * 0.05 / (l * ns )  ) )  );
-      double stdr   = sqrt(er * (1 - (  2 * (window * ns) * 0.05 / (l * ns ) ) )  );
-      BIC_template(segments[i],  BIC_values, densities, densities_r, window, sigma, lambda, foot_print, pi, w);
-      double start = -1, rN = 0.0 , rF = 0.0, rR = 0.0, rB = 0.0;
-      vector<vector<double>> HITS;
-      for (int j = 1; j < segments[i]->XN - 1; j++) {
-         bool HIT = check_hit(BIC_values[j], densities[j], 
-            densities_r[j], SC.threshold, ef + CTT * stdf, er + CTT * stdr  );
-         if (SCORES) {
-            double vl   = BIC_values[j];
-            if (std::isnan(double(vl)) or std::isinf(double(vl))) {
-               vl    = 0;
-            }
-            int DENS    = densities[j] + densities_r[j] ;
-            FHW_scores << segments[i]->chrom << "\t" << to_string(int(segments[i]->X[0][j - 1]*ns + segments[i]->start)) << "\t";
-            FHW_scores << to_string(int(segments[i]->X[0][j]*ns + segments[i]->start )) << "\t" << to_string(vl) + "\t" + to_string(densities[j]) + "\t" + to_string(densities_r[j]) + "\t" +  to_string(int(HIT)) << endl;
-         }
-         if ( HIT ) {
-            if (start < 0) {
-               start = segments[i]->X[0][j - 1] * ns + segments[i]->start;
-            }
-            start += 1, rN += 1 , rF += densities[j], rR += densities_r[j], rB += log10( SC.pvalue(BIC_values[j]) + pow(10, -20)) ;
-         }
-         if (not HIT and start > 0 ) {
-            vector<double> row = {start , segments[i]->X[0][j - 1]*ns + segments[i]->start, rB / rN , rF / rN, rR / rN  };
-            HITS.push_back(row);
-            start = -1, rN = 0.0 , rF = 0.0, rR = 0.0, rB = 0.0;
-         }
-      }
+      vector<vector<double>> HITS   = template_hits(segments[i], segments[i], P, SC, FHW_scores, SCORES, -INF, INF, LG);
       for (int j = 0; j < HITS.size(); j++) {
          segments[i]->bidirectional_bounds.push_back(HITS[j]);
       }
@@ -186,17 +433,89 @@ double run_global_template_matching(vector<segment*> segments,
    return 1.0;
 }
 
+//-tile: every chromosome (segments only name them, start() fills in their totals)
+//is read, binned and scanned one window at a time; the hits of each window's core
+//are stitched together with merge()
+double run_tiled_template_matching(bedgraph_tiles & T, vector<segment*> segments,
+                                   params * P, slice_ratio SC, Log_File * LG) {
+   double ns                     = stod(P->p["-ns"]);
+   double window                 = stod(P->p["-pad"]) / ns;
+   bool SCORES     = not P->p["-scores"].empty();
 
+   ofstream FHW_scores;
 
+   if (SCORES) {
+      FHW_scores.open(P->p["-scores"]);
+   }
+   for (int i = 0; i < segments.size(); i++) {
+      vector<vector<double>> HITS;
+      segment * S;
+      int lo, hi;
+      bool streamed = T.start(segments[i]->chrom, segments[i]);
+      while (streamed and (S = T.next(lo, hi)) != NULL) {
+         vector<vector<double>> W  = template_hits(S, segments[i], P, SC, FHW_scores, SCORES, lo, hi, LG);
+         for (int j = 0; j < W.size(); j++) {
+            W[j][0] = max(W[j][0], double(lo)), W[j][1] = min(W[j][1], double(hi));
+            if (W[j][0] < W[j][1]) {
+               HITS.push_back(W[j]);
+            }
+         }
+         delete S;
+      }
+      if (T.unsorted) {
+         HITS.clear();
+         S     = T.whole();
+         if (S != NULL) {
+            HITS  = template_hits(S, S, P, SC, FHW_scores, SCORES, -INF, INF, LG);
+            delete S;
+         }
+      }
+      if (T.bad_line >= 0) { //the run stops, see bidir_run
+         break;
+      }
+      segments[i]->bidirectional_bounds   = merge(HITS, window * 0.5);
+   }
+   return 1.0;
+}
 
+//every chromosome (segments only name them) is read on a reader thread while the
+//one before it is scanned; the queue keeps at most two read ahead, and scanned
+//chromosomes are freed right away. A line that isn't bedgraph ends the reading and
+//the scan, T.bad_line tells bidir_run
+double run_pipelined_template_matching(bedgraph_tiles & T, vector<segment*> segments,
+                                       params * P, slice_ratio SC, Log_File * LG) {
+   double ns                     = stod(P->p["-ns"]);
+   double window                 = stod(P->p["-pad"]) / ns;
+   bool SCORES     = not P->p["-scores"].empty();
 
+   ofstream FHW_scores;
 
-
-
-
-
-
-
-
-
-
+   if (SCORES) {
+      FHW_scores.open(P->p["-scores"]);
+   }
+   segment_queue Q(2);
+   thread reader([&T, &Q, &segments] {
+      for (int i = 0; i < segments.size(); i++) {
+         segment * S   = T.load(segments[i]->chrom);
+         if (T.bad_line >= 0) {
+            break;
+         }
+         Q.push(S);
+      }
+      Q.close();
+   });
+   bool ok;
+   for (int i = 0; i < segments.size(); i++) {
+      segment * S   = Q.pop(ok);
+      if (not ok) {
+         break;
+      }
+      if (S != NULL) {
+         vector<vector<double>> HITS   = template_hits(S, S, P, SC, FHW_scores, SCORES, -INF, INF, LG);
+         segments[i]->bidirectional_bounds   = merge(HITS, window * 0.5);
+         delete S;
+      }
+   }
+   reader.join();
+   return 1.0;
+}
@@ -6,12 +6,15 @@
 #include <vector>
 #include <iostream>
 #include "FDR.h"
+#include "error_stdo_logging.h"
 using namespace std;
 vector<double> peak_bidirs(segment * );
 int sample_centers(vector<double>, double);
 void noise_global_template_matching(vector<segment*>, double);
 
-double run_global_template_matching(vector<segment*> , string,  params * ,slice_ratio );
+double run_global_template_matching(vector<segment*> , string,  params * ,slice_ratio, Log_File * );
+double run_tiled_template_matching(bedgraph_tiles &, vector<segment*>, params *, slice_ratio, Log_File *);
+double run_pipelined_template_matching(bedgraph_tiles &, vector<segment*>, params *, slice_ratio, Log_File *);
 void EX(vector<segment*> , double, double , double & , double &);
 
 extern double INF;
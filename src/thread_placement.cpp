@@ -0,0 +1,51 @@
+#include "thread_placement.h"
+#include <omp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <vector>
+using namespace std;
+
+void scan_chunk(int N, int threads, int tid, int & start, int & stop) {
+	int counts  = N / threads;
+	start       = tid * counts;
+	stop        = (tid + 1) * counts;
+	if (tid + 1 == threads) {
+		stop  = N;
+	}
+}
+
+//the mask is whatever mpirun / taskset left the process, so ranks sharing a node
+//keep to their own CPUs. "close" puts thread t on the t-th CPU of the mask,
+//"spread" spaces the threads evenly over it (over both sockets of a dual socket
+//node). Returns the number of threads pinned, 0 for "none"
+int pin_threads(string mode) {
+	if (mode != "close" and mode != "spread") {
+		return 0;
+	}
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+		return 0;
+	}
+	vector<int> cpus;
+	for (int c = 0; c < CPU_SETSIZE; c++) {
+		if (CPU_ISSET(c, &allowed)) {
+			cpus.push_back(c);
+		}
+	}
+	if (cpus.empty()) {
+		return 0;
+	}
+	int threads = omp_get_max_threads();
+	int pinned  = 0;
+	#pragma omp parallel num_threads(threads) reduction(+:pinned)
+	{
+		int tid   = omp_get_thread_num();
+		int c     = (mode == "close") ? tid % cpus.size() : (long(tid) * cpus.size() / threads) % cpus.size();
+		cpu_set_t one;
+		CPU_ZERO(&one);
+		CPU_SET(cpus[c], &one);
+		pinned    += (pthread_setaffinity_np(pthread_self(), sizeof(one), &one) == 0);
+	}
+	return pinned;
+}
@@ -0,0 +1,14 @@
+#ifndef thread_placement_H
+#define thread_placement_H
+#include <string>
+using namespace std;
+
+//how the OpenMP threads of a scan split N bins, thread tid gets [start, stop);
+//shared by BIC_template and coverage_block::place so a thread first touches the
+//same bins it later reads
+void scan_chunk(int, int, int, int &, int &);
+
+//-pin: binds each OpenMP thread to one CPU of the process affinity mask
+int pin_threads(string);
+
+#endif